@@ -0,0 +1,57 @@
+#!/bin/bash
+
+#
+# Helpers shared by the measurement scripts, sourced at their start with
+#   . "$(dirname "$0")/common.sh"
+# The scripts are run from the src directory.
+#
+
+script=$(basename "$0" .sh)
+
+error()
+{
+  echo "$script failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+# Starts the engine as a coprocess, driven with send and wait_for
+start_engine() { coproc ENGINE { eval "$WINE_PATH ./stockfish" 2>&1; }; }
+
+send() { echo "$1" >&"${ENGINE[1]}"; }
+
+# Reads the engine output up to the first line starting with $1. The lines
+# before it are passed to on_line, when the script defines it.
+wait_for()
+{
+  while read -r line <&"${ENGINE[0]}"; do
+    [[ $line == $1* ]] && break
+    if declare -F on_line > /dev/null; then on_line "$line"; fi
+  done
+}
+
+stop_engine()
+{
+  send "quit"
+  wait
+}
+
+# Rebuilds the engine with the make arguments in base_makeflags followed by the
+# given ones. The engine found in src at the first call is put back when the
+# script exits, so that no variant is left behind.
+build_variant()
+{
+  if [[ -z $saved_engine ]]; then
+    saved_engine=$(mktemp)
+    trap restore_engine EXIT
+    [[ -f stockfish ]] && cp -p stockfish "$saved_engine"
+  fi
+  make -s objclean
+  make -s -j build $base_makeflags "$@" > /dev/null
+}
+
+restore_engine()
+{
+  make -s objclean
+  if [[ -s $saved_engine ]]; then mv "$saved_engine" stockfish; else rm -f stockfish "$saved_engine"; fi
+}
@@ -0,0 +1,47 @@
+#!/bin/bash
+
+#
+# Checks the deterministic SMP mode and measures its cost. For each thread
+# count the bench positions are searched to a fixed node count several times
+# with the Deterministic option, and the best moves of all the runs must be the
+# same. The speed is compared with the same bench without the option.
+#
+# Run from the src directory with an already built engine, for example:
+#   ../scripts/deterministic_smp.sh 1 4 8
+# The node limit per position and the number of runs can be set with DET_NODES
+# and DET_RUNS.
+#
+
+. "$(dirname "$0")/common.sh"
+
+steps=${*:-"1 4 8"}
+nodes=${DET_NODES:-200000}
+runs=${DET_RUNS:-3}
+
+# Prints the best moves of the bench, followed by its speed in nodes/second
+bench()
+{
+  echo "setoption name Deterministic value $1
+bench 16 $2 $nodes default nodes
+quit" | eval "$WINE_PATH ./stockfish" 2>&1 | awk '/^bestmove/ { print $2 }
+                                                  /^Nodes\/second/ { nps = $3 }
+                                                  END { print nps }'
+}
+
+printf "%-8s %12s %12s %8s %14s\n" "Threads" "nps" "det nps" "cost" "deterministic"
+
+for threads in $steps; do
+  nps=$(bench false "$threads" | tail -n 1)
+
+  result=yes
+  for ((i = 0; i < runs; i++)); do
+    output=$(bench true "$threads")
+    moves=$(echo "$output" | head -n -1)
+    [[ $i -eq 0 ]] && reference=$moves
+    [[ $moves == "$reference" ]] || result=no
+    detnps=$(echo "$output" | tail -n 1)
+  done
+
+  printf "%-8s %12s %12s %7.1f%% %14s\n" "$threads" "$nps" "$detnps" \
+         "$(echo "$nps $detnps" | awk '{ print 100 * (1 - $2 / $1) }')" "$result"
+done
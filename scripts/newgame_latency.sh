@@ -0,0 +1,55 @@
+#!/bin/bash
+
+#
+# Measures the latency from 'ucinewgame' to 'readyok' for several thread counts.
+# For each thread count the engine clears its state a few times and the
+# average clear time reported by the engine and the average wall time until
+# 'readyok' are printed.
+#
+# Run from the src directory with an already built engine, for example:
+#   ../scripts/newgame_latency.sh 1 8 32 256
+# The hash size in MB can be set with NEWGAME_HASH and the number of clears
+# per thread count with NEWGAME_ROUNDS.
+#
+
+. "$(dirname "$0")/common.sh"
+
+steps=${*:-"1 8 32 256"}
+hash=${NEWGAME_HASH:-1024}
+rounds=${NEWGAME_ROUNDS:-5}
+
+start_engine
+
+on_line()
+{
+  [[ $1 == "info string Clear Time:"* ]] && clear=${1##*: } && clear=${clear%ms}
+  return 0
+}
+
+send "setoption name Report Timings value true"
+send "setoption name Hash value $hash"
+send "isready"
+wait_for "readyok"
+
+printf "%-8s %12s %12s\n" "Threads" "Clear (ms)" "Ready (ms)"
+
+for threads in $steps; do
+  send "setoption name Threads value $threads"
+  send "isready"
+  wait_for "readyok"
+
+  clear_sum=0 ready_sum=0
+  for ((i = 0; i < rounds; i++)); do
+    clear=0
+    start=$(date +%s%N)
+    send "ucinewgame"
+    send "isready"
+    wait_for "readyok"
+    ready_sum=$((ready_sum + ($(date +%s%N) - start) / 1000000))
+    clear_sum=$((clear_sum + clear))
+  done
+
+  printf "%-8s %12s %12s\n" "$threads" "$((clear_sum / rounds))" "$((ready_sum / rounds))"
+done
+
+stop_engine
@@ -0,0 +1,40 @@
+#!/bin/bash
+
+#
+# Compares Lazy SMP with the RootSplit work-stealing scheduler on bench.
+# For each thread count bench is run to a fixed depth in both modes. The time
+# is the time to reach that depth on all positions and the speedup is relative
+# to a single thread searching to the same depth.
+#
+# Run from the src directory with an already built engine, for example:
+#   ../scripts/smp_scaling.sh 20
+# The thread counts can be changed with SMP_THREADS, e.g. SMP_THREADS="8 16",
+# and the hash size in MB with SMP_HASH.
+#
+
+. "$(dirname "$0")/common.sh"
+
+depth=${1:-20}
+hash=${SMP_HASH:-1024}
+
+run_bench()
+{
+  printf "setoption name RootSplit value %s\nbench %s %s %s default depth\nquit\n" \
+    "$1" "$hash" "$2" "$depth" | eval "$WINE_PATH ./stockfish" 2>&1
+}
+
+base=$(run_bench false 1 | awk '/Total time/ {print $5}')
+
+printf "%-8s %-10s %12s %12s %8s\n" "Threads" "Mode" "Nodes" "Time (ms)" "Speedup"
+
+for threads in ${SMP_THREADS:-8 32 128 256}; do
+  for mode in lazysmp rootsplit; do
+    output=$(run_bench $([ $mode = rootsplit ] && echo true || echo false) $threads)
+
+    nodes=$(echo "$output" | awk '/Nodes searched/ {print $4}')
+    time=$(echo "$output" | awk '/Total time/ {print $5}')
+    speedup=$(awk -v b="$base" -v t="$time" 'BEGIN { printf "%.2f", b / (t ? t : 1) }')
+
+    printf "%-8s %-10s %12s %12s %8s\n" "$threads" "$mode" "$nodes" "$time" "$speedup"
+  done
+done
@@ -0,0 +1,97 @@
+#!/bin/bash
+
+#
+# Measures the latency until 'bestmove' once a search has to end, for several
+# thread counts. Three cases are timed:
+#   stop       'go infinite', then 'stop' after a random delay
+#   ponderhit  'go ponder movetime 50', then 'ponderhit' after the movetime is
+#              already over, so that the search has to stop at once
+#   movetime   'go movetime 50', the latency is the time past the 50 ms
+# and the 50th, 90th and 99th percentiles and the maximum are printed in ms.
+#
+# Run from the src directory with an already built engine, for example:
+#   ../scripts/stop_latency.sh 1 8 32
+# The number of searches per case can be set with STOP_ROUNDS. STOP_LOAD busy
+# processes can be run alongside the engine to measure it on a loaded machine.
+#
+
+. "$(dirname "$0")/common.sh"
+
+steps=${*:-"1 8 32"}
+rounds=${STOP_ROUNDS:-100}
+load=${STOP_LOAD:-0}
+
+start_engine
+
+loaders=()
+for ((i = 0; i < load; i++)); do
+  while :; do :; done &
+  loaders+=($!)
+done
+((load > 0)) && trap 'kill "${loaders[@]}"' EXIT
+
+# Time in microseconds, without forking a process
+usec() { echo $((${EPOCHREALTIME/./} + 0)); }
+
+# Sleeps between 20 and 200 ms
+random_sleep() { sleep "0.$(printf "%03d" $((20 + RANDOM % 181)))"; }
+
+# Prints the percentiles of the latencies in microseconds given on stdin
+report()
+{
+  sort -n | awk -v name="$1" -v threads="$2" '
+    { v[NR] = $1 }
+    END {
+      printf "%-8s %-10s %10.2f %10.2f %10.2f %10.2f\n", threads, name,
+             v[int(NR * 0.50 + 0.5)] / 1000, v[int(NR * 0.90 + 0.5)] / 1000,
+             v[int(NR * 0.99 + 0.5)] / 1000, v[NR] / 1000
+    }'
+}
+
+send "position startpos"
+send "isready"
+wait_for "readyok"
+
+printf "%-8s %-10s %10s %10s %10s %10s\n" "Threads" "Case" "p50 (ms)" "p90 (ms)" "p99 (ms)" \
+       "max (ms)"
+
+for threads in $steps; do
+  send "setoption name Threads value $threads"
+  send "isready"
+  wait_for "readyok"
+
+  samples=()
+  for ((i = 0; i < rounds; i++)); do
+    send "go infinite"
+    random_sleep
+    start=$(usec)
+    send "stop"
+    wait_for "bestmove"
+    samples+=($(($(usec) - start)))
+  done
+  printf "%s\n" "${samples[@]}" | report "stop" "$threads"
+
+  samples=()
+  for ((i = 0; i < rounds; i++)); do
+    send "go ponder movetime 50"
+    random_sleep
+    start=$(usec)
+    send "ponderhit"
+    wait_for "bestmove"
+    samples+=($(($(usec) - start)))
+  done
+  printf "%s\n" "${samples[@]}" | report "ponderhit" "$threads"
+
+  samples=()
+  for ((i = 0; i < rounds; i++)); do
+    start=$(usec)
+    send "go movetime 50"
+    wait_for "bestmove"
+    latency=$(($(usec) - start - 50000))
+    samples+=($((latency > 0 ? latency : 0)))
+  done
+  printf "%s\n" "${samples[@]}" | report "movetime" "$threads"
+done
+
+((load > 0)) && kill "${loaders[@]}" && trap - EXIT
+stop_engine
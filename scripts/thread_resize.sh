@@ -0,0 +1,44 @@
+#!/bin/bash
+
+#
+# Measures the latency of thread pool changes through 'setoption name Threads'.
+# The engine is started once and walks through the given thread counts,
+# reporting for each step the time spent resizing the thread pool and the time
+# spent reallocating the hash (0 when it is kept), as reported by the engine,
+# and the total wall time until the engine answered 'isready'.
+#
+# Run from the src directory with an already built engine, for example:
+#   ../scripts/thread_resize.sh 256 8 256 128 256 1
+#
+
+. "$(dirname "$0")/common.sh"
+
+steps=${*:-"256 8 256 128 256 1"}
+
+start_engine
+
+on_line()
+{
+  [[ $1 == "info string Thread Pool Resize Time:"* ]] && resize=${1##*: }
+  [[ $1 == "info string Hash Allocation Time:"* ]] && hash=${1##*: }
+  return 0
+}
+
+send "setoption name Report Timings value true"
+send "isready"
+wait_for "readyok"
+
+printf "%-8s %12s %12s %12s\n" "Threads" "Resize" "Hash" "Total (ms)"
+
+for threads in $steps; do
+  resize="" hash=""
+  start=$(date +%s%N)
+  send "setoption name Threads value $threads"
+  send "isready"
+  wait_for "readyok"
+  total=$((($(date +%s%N) - start) / 1000000))
+
+  printf "%-8s %12s %12s %12s\n" "$threads" "$resize" "$hash" "$total"
+done
+
+stop_engine
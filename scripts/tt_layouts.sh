@@ -0,0 +1,35 @@
+#!/bin/bash
+
+#
+# Compares the transposition table cluster layouts on bench.
+# For each layout the engine is rebuilt and bench is run to a fixed depth.
+# Fewer nodes means better replacement, nps shows the probe cost and
+# hashfull is the average table occupation at the end of each position.
+#
+# Run from the src directory, for example:
+#   ../scripts/tt_layouts.sh 64 1 16
+# Extra make arguments can be passed in TT_LAYOUTS_MAKEFLAGS, e.g. ARCH=x86-64-avx2
+# The engine in src before the run is put back at the end.
+#
+
+. "$(dirname "$0")/common.sh"
+
+base_makeflags=$TT_LAYOUTS_MAKEFLAGS
+bench_args=${*:-"64 1 16"}
+
+printf "%-10s %12s %12s %10s\n" "Cluster" "Nodes" "Nodes/sec" "Hashfull"
+
+for layout in 32 64; do
+  build_variant ttcluster=$layout
+
+  output=$(eval "$WINE_PATH ./stockfish bench $bench_args 2>&1")
+
+  nodes=$(echo "$output" | awk '/Nodes searched/ {print $4}')
+  nps=$(echo "$output" | awk '/Nodes\/second/ {print $3}')
+  hashfull=$(echo "$output" | awk '
+    /^Position:/ { if (h != "") { s += h; n++ } h = "" }
+    / hashfull / { for (i = 1; i < NF; i++) if ($i == "hashfull") h = $(i + 1) }
+    END { if (h != "") { s += h; n++ } print n ? int(s / n) : 0 }')
+
+  printf "%-10s %12s %12s %10s\n" "${layout}B" "$nodes" "$nps" "$hashfull"
+done
@@ -0,0 +1,32 @@
+#!/bin/bash
+
+#
+# Compares the transposition table replacement policies on bench.
+# For each policy the engine is rebuilt and bench is run to a fixed depth.
+# Fewer nodes means the policy keeps the more useful entries, the total
+# time is the time to reach the depth on all positions.
+#
+# Run from the src directory, for example:
+#   ../scripts/tt_replacement.sh 64 1 16
+# Extra make arguments can be passed in TT_REPLACEMENT_MAKEFLAGS, e.g. ttcluster=64
+# The engine in src before the run is put back at the end.
+#
+
+. "$(dirname "$0")/common.sh"
+
+base_makeflags=$TT_REPLACEMENT_MAKEFLAGS
+bench_args=${*:-"64 1 16"}
+
+printf "%-10s %12s %12s %12s\n" "Policy" "Nodes" "Time (ms)" "Nodes/sec"
+
+for policy in depthage depth always twotier; do
+  build_variant ttreplace=$policy
+
+  output=$(eval "$WINE_PATH ./stockfish bench $bench_args 2>&1")
+
+  nodes=$(echo "$output" | awk '/Nodes searched/ {print $4}')
+  time=$(echo "$output" | awk '/Total time/ {print $5}')
+  nps=$(echo "$output" | awk '/Nodes\/second/ {print $3}')
+
+  printf "%-10s %12s %12s %12s\n" "$policy" "$nodes" "$time" "$nps"
+done
@@ -18,13 +18,42 @@
 
 #include "benchmark.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "movegen.h"
+#include "nnue/network.h"
+#include "nnue/nnue_accumulator.h"
+#include "position.h"
+#include "tt.h"
+#include "types.h"
+#include "uci.h"
+
+#if defined(__linux__) && !defined(__ANDROID__)
+    #include <dirent.h>
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
 namespace {
 
+constexpr auto StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
 // clang-format off
 const std::vector<std::string> Defaults = {
   "setoption name UCI_Chess960 value false",
@@ -160,4 +189,653 @@ std::vector<std::string> setup_bench(const std::string& currentFen, std::istream
     return list;
 }
 
-}  // namespace Stockfish
\ No newline at end of file
+
+// Hammers the transposition table from 1, 2, 4, ... maxThreads threads for
+// runTime milliseconds each and reports probe throughput together with the
+// number of hits whose data does not belong to the probed key. Every key is
+// always stored with the same data and no two keys share their low 16 bits,
+// so any such hit is an entry torn by concurrent writers. Compare a default
+// build against one compiled with verifytt=yes.
+void tt_stress(TranspositionTable& tt, size_t maxThreads, TimePoint runTime) {
+
+    constexpr uint64_t KeySpace = 1 << 16;
+
+    auto key_of = [](uint64_t i) { return ((i * 0x9E3779B97F4A7C15ULL) & ~0xFFFFULL) | i; };
+
+#ifdef TT_VERIFY
+    std::cerr << "\nTT entry verification: enabled" << std::endl;
+#else
+    std::cerr << "\nTT entry verification: disabled" << std::endl;
+#endif
+
+    for (size_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+    {
+        std::atomic<bool>     stop{false};
+        std::atomic<uint64_t> probes{0}, hits{0}, corrupt{0};
+        std::vector<std::thread> workers;
+
+        tt.new_search();
+
+        for (size_t t = 0; t < threadCount; ++t)
+            workers.emplace_back([&, t]() {
+                PRNG        rng(t + 1);
+                uint64_t    n = 0, h = 0, c = 0;
+                TTOccupancy occupancy{};  // Not merged, the table is resized afterwards
+
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    const Key   key   = key_of(rng.rand<uint64_t>() % KeySpace);
+                    const Value value = Value(int16_t(key >> 16));
+                    const Value eval  = Value(int16_t(key >> 48));
+                    const Move  move  = Move(uint16_t(key >> 32) | 1);
+                    const Depth depth = Depth(1 + (key >> 24) % 200);
+
+                    bool     found;
+                    TTEntry* tte = tt.probe(key, found);
+
+                    if (found)
+                    {
+                        ++h;
+                        c += tte->value() != value || tte->eval() != eval || tte->move() != move
+                          || tte->depth() != depth;
+                    }
+                    else
+                        tte->save(key, value, false, BOUND_EXACT, depth, move, eval,
+                                  tt.generation(), tt.slot(tte), occupancy);
+                    ++n;
+                }
+
+                probes += n, hits += h, corrupt += c;
+            });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(runTime));
+        stop = true;
+
+        for (auto& th : workers)
+            th.join();
+
+        std::cerr << "Threads: " << std::setw(4) << threadCount
+                  << "  Probes/second: " << std::setw(11) << 1000 * probes / runTime
+                  << "  Hits: " << std::setw(11) << hits << "  Corrupt hits: " << std::setw(8)
+                  << corrupt << "  (" << std::fixed << std::setprecision(3)
+                  << (hits ? 1e6 * corrupt / hits : 0.0) << " ppm)" << std::endl;
+    }
+}
+
+
+// Measures the throughput of the batched evaluation with batches of 1 up to
+// MaxBatchSize sibling positions. The children of each bench position are
+// evaluated in batches taken in move order, like the moves of a node would be.
+// The accumulators are all computed before the timing, so mostly the transform
+// and the layer stacks are measured. Every value is checked against evaluate(),
+// whose throughput is given as 'single'.
+void eval_batch(const Eval::NNUE::Networks& networks, TimePoint runTime) {
+
+    using namespace Eval::NNUE;
+
+    std::deque<StateInfo>                     states;
+    std::vector<std::unique_ptr<Position>>    positions;
+    std::vector<std::vector<const Position*>> families;
+    bool                                      chess960 = false;
+
+    for (const std::string& fen : Defaults)
+    {
+        if (fen.find("setoption") != std::string::npos)
+        {
+            chess960 = fen.find("UCI_Chess960 value true") != std::string::npos;
+            continue;
+        }
+
+        Position root;
+        root.set(fen, chess960, &states.emplace_back());
+
+        std::vector<const Position*> children;
+
+        for (const auto& m : MoveList<LEGAL>(root))
+        {
+            auto& child = positions.emplace_back(std::make_unique<Position>());
+            child->set(fen, chess960, &states.emplace_back());
+            child->do_move(m, states.emplace_back());
+            children.push_back(child.get());
+        }
+
+        if (!children.empty())
+            families.push_back(std::move(children));
+    }
+
+    auto caches = std::make_unique<AccumulatorCaches>(networks);
+
+    auto run = [&](const auto& network, auto* cache, const std::string& name) {
+        std::vector<std::vector<Value>> reference;
+
+        for (const auto& family : families)
+        {
+            auto& values = reference.emplace_back();
+            for (const Position* pos : family)
+                values.push_back(network.evaluate(*pos, cache));
+        }
+
+        std::cerr << "\nNetwork: " << name << "\n"
+                  << "Batch    Evals/second   Speedup  Mismatches" << std::endl;
+
+        double single = 0;
+
+        // Batch size 0 stands for evaluate() on one position at a time
+        for (size_t size = 0; size <= MaxBatchSize; ++size)
+        {
+            uint64_t  evals = 0, mismatches = 0;
+            TimePoint start = now(), elapsed;
+            Value     values[MaxBatchSize];
+
+            const size_t step = std::max(size, size_t(1));
+
+            do
+                for (size_t f = 0; f < families.size(); ++f)
+                    for (size_t i = 0; i < families[f].size(); i += step)
+                    {
+                        const size_t n = std::min(step, families[f].size() - i);
+
+                        if (size)
+                            network.evaluate_batch(&families[f][i], n, cache, values);
+                        else
+                            values[0] = network.evaluate(*families[f][i], cache);
+
+                        for (size_t j = 0; j < n; ++j)
+                            mismatches += values[j] != reference[f][i + j];
+
+                        evals += n;
+                    }
+            while ((elapsed = now() - start) < runTime);
+
+            const double rate = 1000.0 * evals / std::max(elapsed, TimePoint(1));
+
+            if (!size)
+                single = rate;
+
+            std::cerr << std::setw(6) << (size ? std::to_string(size) : "single")
+                      << std::setw(15) << uint64_t(rate) << std::setw(10) << std::fixed
+                      << std::setprecision(2) << rate / single << std::setw(12) << mismatches
+                      << std::endl;
+        }
+    };
+
+    run(networks.big, &caches->big, "big");
+    run(networks.small, &caches->small, "small");
+}
+
+
+// Times the update of the accumulators when the nearest computed accumulator
+// is 1 to MaxGap plies back, on a line of moves played from each bench position
+// with enough pieces for no refresh to be needed. King moves are not played.
+void accumulator_update(const Eval::NNUE::Networks& networks, TimePoint runTime) {
+
+    using namespace Eval::NNUE;
+
+    constexpr int MaxGap = 6;
+
+    auto caches = std::make_unique<AccumulatorCaches>(networks);
+
+    auto run = [&](const auto& network, auto* cache, auto accPtr, const std::string& name) {
+        std::deque<StateInfo>                  states;
+        std::vector<std::unique_ptr<Position>> lines;
+        bool                                   chess960 = false;
+
+        for (const std::string& fen : Defaults)
+        {
+            if (fen.find("setoption") != std::string::npos)
+            {
+                chess960 = fen.find("UCI_Chess960 value true") != std::string::npos;
+                continue;
+            }
+
+            auto& pos = lines.emplace_back(std::make_unique<Position>());
+            pos->set(fen, chess960, &states.emplace_back());
+            network.update_accumulators(*pos, cache);
+
+            int ply = 0;
+            for (; ply < MaxGap; ++ply)
+            {
+                std::vector<Move> moves;
+                for (const auto& m : MoveList<LEGAL>(*pos))
+                    if (type_of(pos->moved_piece(m)) != KING)
+                        moves.push_back(m);
+
+                if (moves.empty())
+                    break;
+
+                // Spread the choice, so that a piece does not just go back and forth
+                pos->do_move(moves[ply * 7 % moves.size()], states.emplace_back());
+                network.update_accumulators(*pos, cache);
+            }
+
+            // A ply costs at most 4 in the refresh heuristic of the feature set
+            if (ply < MaxGap || pos->count<ALL_PIECES>() < 4 * MaxGap)
+                lines.pop_back();
+        }
+
+        std::cerr << "\nNetwork: " << name << ", " << lines.size() << " lines\n"
+                  << "Gap  Updates/second  ns/update    ns/ply  vs stepwise" << std::endl;
+
+        double single = 0;
+
+        for (int gap = 1; gap <= MaxGap; ++gap)
+        {
+            uint64_t  updates = 0;
+            TimePoint start   = now(), elapsed;
+
+            do
+                for (const auto& pos : lines)
+                {
+                    StateInfo* st = pos->state();
+                    for (int i = 0; i < gap; ++i, st = st->previous)
+                        (st->*accPtr).computed[WHITE] = (st->*accPtr).computed[BLACK] = false;
+
+                    network.update_accumulators(*pos, cache);
+                    ++updates;
+                }
+            while ((elapsed = now() - start) < runTime);
+
+            const double ns = 1e6 * elapsed / std::max(updates, uint64_t(1));
+
+            if (gap == 1)
+                single = ns;
+
+            // The last column compares with updating one ply at a time
+            std::cerr << std::setw(3) << gap << std::setw(16) << uint64_t(1e9 / ns)
+                      << std::setw(11) << std::fixed << std::setprecision(1) << ns
+                      << std::setw(10) << ns / gap << std::setw(13) << std::setprecision(2)
+                      << ns / (gap * single) << std::endl;
+        }
+    };
+
+    run(networks.big, &caches->big, &StateInfo::accumulatorBig, "big");
+    run(networks.small, &caches->small, &StateInfo::accumulatorSmall, "small");
+}
+
+
+namespace {
+
+// Calls op(i) for each of the count elements of a stream, over and over until
+// runTime is over, and returns the mean time of a call in nanoseconds.
+template<typename Op>
+double ns_per_op(size_t count, TimePoint runTime, Op&& op) {
+
+    using namespace std::chrono;
+
+    uint64_t   calls   = 0;
+    const auto start   = steady_clock::now();
+    auto       elapsed = start - start;
+
+    do
+    {
+        for (size_t i = 0; i < count; ++i)
+            op(i);
+        calls += count;
+    } while (count && (elapsed = steady_clock::now() - start) < milliseconds(runTime));
+
+    return double(duration_cast<nanoseconds>(elapsed).count()) / std::max(calls, uint64_t(1));
+}
+
+}  // namespace
+
+// Times the parts of the NNUE inference separately: the refresh and the
+// incremental update of the accumulators, the output of the feature
+// transformer, each layer of the layer stack and the whole evaluate().
+// The positions are those after each move of a stream, read from a file with
+// lines like the arguments of the UCI 'position' command, for instance a log
+// of a GUI session, or by default 16 moves played from each bench position.
+// Returns false if the file cannot be read or the fc_0 kernels differ.
+bool nnue_bench(const Eval::NNUE::Networks& networks,
+                TimePoint                   runTime,
+                const std::string&          file) {
+
+    using namespace Eval::NNUE;
+
+    constexpr int DefaultPlies = 16;
+
+    struct Line {
+        std::string              fen;
+        bool                     chess960;
+        std::vector<std::string> moves;
+    };
+
+    std::vector<Line> lines;
+
+    if (file.empty())
+    {
+        bool chess960 = false;
+
+        for (const std::string& fen : Defaults)
+        {
+            if (fen.find("setoption") != std::string::npos)
+            {
+                chess960 = fen.find("UCI_Chess960 value true") != std::string::npos;
+                continue;
+            }
+
+            StateListPtr states(new std::deque<StateInfo>(1));
+            Position     pos;
+            pos.set(fen, chess960, &states->back());
+
+            Line& line = lines.emplace_back(Line{fen, chess960, {}});
+
+            for (int ply = 0; ply < DefaultPlies; ++ply)
+            {
+                MoveList<LEGAL> legal(pos);
+                if (!legal.size())
+                    break;
+
+                // Spread the choice, so that a piece does not just go back and forth
+                const Move m = legal.begin()[ply * 7 % legal.size()];
+                line.moves.push_back(UCIEngine::move(m, chess960));
+                pos.do_move(m, states->emplace_back());
+            }
+        }
+    }
+    else
+    {
+        std::ifstream stream(file);
+        std::string   text, token;
+
+        if (!stream.is_open())
+        {
+            std::cerr << "Unable to open file " << file << std::endl;
+            return false;
+        }
+
+        while (std::getline(stream, text))
+        {
+            std::istringstream is(text);
+            std::string        fen;
+
+            is >> token;
+            if (token == "position")
+                is >> token;
+
+            if (token == "startpos")
+            {
+                fen = StartFEN;
+                is >> token;  // Consume the "moves" token, if any
+            }
+            else if (token == "fen")
+                while (is >> token && token != "moves")
+                    fen += token + " ";
+            else
+                continue;
+
+            Line& line = lines.emplace_back(Line{fen, false, {}});
+            while (is >> token)
+                line.moves.push_back(token);
+        }
+    }
+
+    auto caches = std::make_unique<AccumulatorCaches>(networks);
+
+#if defined(USE_AVX512ICL)
+    uint64_t mismatches = 0;
+#endif
+
+    // Each position of the stream gets its own chain of two states, the one of
+    // the previous position and its own, with the accumulators of the previous
+    // position computed. Like this, they can be replayed in any order.
+    std::deque<StateInfo>                  states;
+    std::vector<std::unique_ptr<Position>> positions;
+    std::vector<bool>                      kingMoves;
+
+    for (const Line& line : lines)
+    {
+        StateListPtr lineStates(new std::deque<StateInfo>(1));
+        Position     pos;
+        pos.set(line.fen, line.chess960, &lineStates->back());
+
+        for (const std::string& token : line.moves)
+        {
+            const Move m = UCIEngine::to_move(pos, token);
+            if (m == Move::none())
+                break;
+
+            auto& next = positions.emplace_back(std::make_unique<Position>());
+            next->set(pos.fen(), line.chess960, &states.emplace_back());
+            networks.big.update_accumulators(*next, &caches->big);
+            networks.small.update_accumulators(*next, &caches->small);
+            next->do_move(m, states.emplace_back());
+
+            kingMoves.push_back(type_of(pos.moved_piece(m)) == KING);
+            pos.do_move(m, lineStates->emplace_back());
+        }
+    }
+
+    std::cerr << "\n" << compiler_info() << "Positions: " << positions.size() << std::endl;
+
+    auto run = [&](const auto& network, auto* cache, auto accPtr, const std::string& name) {
+        using Arch = std::decay_t<decltype(network.layer_stack(0))>;
+
+        struct alignas(CacheLineSize) Buffers {
+            alignas(CacheLineSize) TransformedFeatureType
+              features[FeatureTransformer<Arch::TransformedFeatureDimensions, nullptr>::BufferSize];
+            alignas(CacheLineSize) typename decltype(Arch::fc_0)::OutputBuffer fc_0_out;
+#if defined(USE_AVX512ICL)
+            alignas(CacheLineSize) typename decltype(Arch::fc_0)::OutputBuffer fc_0_generic_out;
+#endif
+            alignas(CacheLineSize) typename decltype(Arch::ac_sqr_0)::OutputType
+              ac_sqr_0_out[ceil_to_multiple<IndexType>(Arch::FC_0_OUTPUTS * 2, 32)];
+            alignas(CacheLineSize) typename decltype(Arch::ac_0)::OutputBuffer ac_0_out;
+            alignas(CacheLineSize) typename decltype(Arch::fc_1)::OutputBuffer fc_1_out;
+            alignas(CacheLineSize) typename decltype(Arch::ac_1)::OutputBuffer ac_1_out;
+            alignas(CacheLineSize) typename decltype(Arch::fc_2)::OutputBuffer fc_2_out;
+        };
+
+        const size_t         count = positions.size();
+        std::vector<Buffers> buffers(count);
+        std::vector<int>     buckets;
+        std::vector<size_t>  updates;  // Positions after a move that is not a king move
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            buckets.push_back((positions[i]->count<ALL_PIECES>() - 1) / 4);
+
+            if (!kingMoves[i])
+                updates.push_back(i);
+        }
+
+        auto reset = [&](StateInfo* st) {
+            (st->*accPtr).computed[WHITE] = (st->*accPtr).computed[BLACK] = false;
+        };
+
+        auto layers = [&](size_t i) -> const Arch& { return network.layer_stack(buckets[i]); };
+
+        // Run in an order that keeps the accumulators of the previous positions
+        // computed until the refresh, which has to clear them.
+        std::vector<std::pair<std::string, double>> results;
+
+        const double update = ns_per_op(updates.size(), runTime, [&](size_t i) {
+            reset(positions[updates[i]]->state());
+            network.update_accumulators(*positions[updates[i]], cache);
+        });
+
+        const double evaluate = ns_per_op(count, runTime, [&](size_t i) {
+            reset(positions[i]->state());
+            network.evaluate(*positions[i], cache);
+        });
+
+        results.emplace_back("FT output", ns_per_op(count, runTime, [&](size_t i) {
+            network.feature_transformer().transform(*positions[i], cache, buffers[i].features,
+                                                    buckets[i]);
+        }));
+
+        results.emplace_back("fc_0 sparse affine", ns_per_op(count, runTime, [&](size_t i) {
+            layers(i).fc_0.propagate(buffers[i].features, buffers[i].fc_0_out);
+        }));
+
+#if defined(USE_AVX512ICL)
+        // The kernel shared by the other architectures, which must give the
+        // same output as the AVX512ICL one
+        results.emplace_back("fc_0 generic kernel", ns_per_op(count, runTime, [&](size_t i) {
+            layers(i).fc_0.propagate_generic(buffers[i].features, buffers[i].fc_0_generic_out);
+        }));
+
+        uint64_t differing = 0;
+        for (const auto& b : buffers)
+            differing += !std::equal(b.fc_0_out, b.fc_0_out + Arch::FC_0_OUTPUTS + 1,
+                                     b.fc_0_generic_out);
+        mismatches += differing;
+#endif
+
+        results.emplace_back("ac_sqr_0 sqr clipped ReLU", ns_per_op(count, runTime, [&](size_t i) {
+            layers(i).ac_sqr_0.propagate(buffers[i].fc_0_out, buffers[i].ac_sqr_0_out);
+        }));
+
+        results.emplace_back("ac_0 clipped ReLU", ns_per_op(count, runTime, [&](size_t i) {
+            layers(i).ac_0.propagate(buffers[i].fc_0_out, buffers[i].ac_0_out);
+        }));
+
+        // Concatenation of the outputs of ac_sqr_0 and ac_0, as done by propagate()
+        for (auto& b : buffers)
+            std::memcpy(b.ac_sqr_0_out + Arch::FC_0_OUTPUTS, b.ac_0_out,
+                        Arch::FC_0_OUTPUTS * sizeof(b.ac_0_out[0]));
+
+        results.emplace_back("fc_1 affine", ns_per_op(count, runTime, [&](size_t i) {
+            layers(i).fc_1.propagate(buffers[i].ac_sqr_0_out, buffers[i].fc_1_out);
+        }));
+
+        results.emplace_back("ac_1 clipped ReLU", ns_per_op(count, runTime, [&](size_t i) {
+            layers(i).ac_1.propagate(buffers[i].fc_1_out, buffers[i].ac_1_out);
+        }));
+
+        results.emplace_back("fc_2 affine", ns_per_op(count, runTime, [&](size_t i) {
+            layers(i).fc_2.propagate(buffers[i].ac_1_out, buffers[i].fc_2_out);
+        }));
+
+        const double refresh = ns_per_op(count, runTime, [&](size_t i) {
+            reset(positions[i]->state());
+            reset(positions[i]->state()->previous);
+            network.update_accumulators(*positions[i], cache);
+        });
+
+        results.insert(results.begin(), {{"FT refresh", refresh}, {"FT update", update}});
+        results.emplace_back("evaluate", evaluate);
+
+        std::cerr << "\nNetwork: " << name << "\n"
+                  << "Operation                        ns/op  % of evaluate" << std::endl;
+
+        for (const auto& [operation, ns] : results)
+            std::cerr << std::left << std::setw(27) << operation << std::right << std::setw(12)
+                      << std::fixed << std::setprecision(1) << ns << std::setw(15)
+                      << 100 * ns / evaluate << std::endl;
+
+#if defined(USE_AVX512ICL)
+        std::cerr << "Positions with fc_0 outputs differing between the kernels: " << differing
+                  << std::endl;
+#endif
+    };
+
+    run(networks.big, &caches->big, &StateInfo::accumulatorBig, "big");
+    run(networks.small, &caches->small, &StateInfo::accumulatorSmall, "small");
+
+#if defined(USE_AVX512ICL)
+    // The AVX512ICL kernel must be bit-exact, so that the bench signature does
+    // not depend on it. Fail the run, and so CI, if it is not.
+    if (mismatches)
+    {
+        std::cerr << "\nError: the fc_0 kernels differ on " << mismatches << " positions"
+                  << std::endl;
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+std::optional<size_t> resident_memory() {
+
+    // The second field is the number of resident pages
+    std::ifstream statm("/proc/self/statm");
+    size_t        size, resident;
+
+    if (!(statm >> size >> resident))
+        return std::nullopt;
+
+    return resident * size_t(sysconf(_SC_PAGESIZE));
+}
+
+#else
+
+std::optional<size_t> resident_memory() { return std::nullopt; }
+
+#endif
+
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(SYS_perf_event_open)
+
+TlbMissCounter::TlbMissCounter() {
+
+    constexpr uint64_t DtlbReadMiss = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+    perf_event_attr attr{};
+    attr.type           = PERF_TYPE_HW_CACHE;
+    attr.size           = sizeof(attr);
+    attr.config         = DtlbReadMiss;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+
+    DIR* tasks = opendir("/proc/self/task");
+    if (!tasks)
+        return;
+
+    // One event per thread, on any CPU, no group. If a thread cannot be counted
+    // the total would be wrong, so nothing is counted.
+    bool failed = false;
+    while (dirent* task = readdir(tasks))
+    {
+        const pid_t tid = pid_t(std::atoi(task->d_name));
+        if (tid <= 0)
+            continue;
+
+        const int fd = int(syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0));
+        if (fd == -1)
+        {
+            failed = true;
+            break;
+        }
+        fds.push_back(fd);
+    }
+    closedir(tasks);
+
+    if (failed)
+    {
+        for (int fd : fds)
+            ::close(fd);
+        fds.clear();
+    }
+}
+
+TlbMissCounter::~TlbMissCounter() {
+    for (int fd : fds)
+        ::close(fd);
+}
+
+uint64_t TlbMissCounter::count() const {
+
+    uint64_t sum = 0;
+    for (int fd : fds)
+    {
+        uint64_t value = 0;
+        if (::read(fd, &value, sizeof(value)) == sizeof(value))
+            sum += value;
+    }
+    return sum;
+}
+
+#else
+
+TlbMissCounter::TlbMissCounter() {}
+TlbMissCounter::~TlbMissCounter() {}
+uint64_t TlbMissCounter::count() const { return 0; }
+
+#endif
+
+}  // namespace Stockfish
@@ -19,14 +19,59 @@
 #ifndef BENCHMARK_H_INCLUDED
 #define BENCHMARK_H_INCLUDED
 
+#include <cstddef>
+#include <cstdint>
 #include <iosfwd>
+#include <optional>
 #include <string>
 #include <vector>
 
+#include "misc.h"
+
+namespace Stockfish {
+class TranspositionTable;
+}
+
+namespace Stockfish::Eval::NNUE {
+struct Networks;
+}
+
 namespace Stockfish::Benchmark {
 
 std::vector<std::string> setup_bench(const std::string&, std::istream&);
 
+void tt_stress(TranspositionTable& tt, size_t maxThreads, TimePoint runTime);
+
+void eval_batch(const Eval::NNUE::Networks& networks, TimePoint runTime);
+
+void accumulator_update(const Eval::NNUE::Networks& networks, TimePoint runTime);
+
+bool nnue_bench(const Eval::NNUE::Networks& networks,
+                TimePoint                   runTime,
+                const std::string&          file);
+
+// Resident memory of the process in bytes, or std::nullopt where it is not known
+std::optional<size_t> resident_memory();
+
+// Counts the data TLB load misses in user space of the threads of the process
+// that exist when it is created, such as the search threads, with one Linux perf
+// event per thread. Where perf events are not available, for instance on other
+// systems or with a restrictive perf_event_paranoid, valid() is false.
+class TlbMissCounter {
+   public:
+    TlbMissCounter();
+    ~TlbMissCounter();
+
+    TlbMissCounter(const TlbMissCounter&)            = delete;
+    TlbMissCounter& operator=(const TlbMissCounter&) = delete;
+
+    bool     valid() const { return !fds.empty(); }
+    uint64_t count() const;
+
+   private:
+    std::vector<int> fds;
+};
+
 }  // namespace Stockfish
 
 #endif  // #ifndef BENCHMARK_H_INCLUDED
@@ -18,16 +18,21 @@
 
 #include "engine.h"
 
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <deque>
 #include <iosfwd>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <sstream>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "benchmark.h"
 #include "evaluate.h"
 #include "misc.h"
 #include "nnue/network.h"
@@ -46,6 +51,25 @@ namespace NN = Eval::NNUE;
 
 constexpr auto StartFEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
+namespace {
+
+// Networks loaded by the engines of this process, by the files they come from
+// and the NUMA config they are replicated for. An engine loading the same files
+// as another one shares its read-only replicas instead of loading its own, so
+// each further engine only costs its hash table and its workers. The mutex is
+// held while the networks of any engine are loaded or replicated.
+struct NetworkRegistry {
+    std::mutex                                                      mutex;
+    std::map<std::string, std::vector<std::weak_ptr<NN::Networks>>> replicas;
+};
+
+NetworkRegistry& network_registry() {
+    static NetworkRegistry registry;
+    return registry;
+}
+
+}  // namespace
+
 Engine::Engine(std::string path) :
     binaryDirectory(CommandLine::get_binary_directory(path)),
     numaContext(NumaConfig::from_system()),
@@ -60,12 +84,37 @@ Engine::Engine(std::string path) :
     capSq = SQ_NONE;
 }
 
+Engine::~Engine() { wait_for_search_finished(); }
+
 std::uint64_t Engine::perft(const std::string& fen, Depth depth, bool isChess960) {
     verify_networks();
 
     return Benchmark::perft(fen, depth, isChess960);
 }
 
+void Engine::tt_stress(size_t maxThreads, TimePoint runTime, size_t mb) {
+    wait_for_search_finished();
+
+    tt.resize(mb, threads);
+    Benchmark::tt_stress(tt, maxThreads, runTime);
+    tt.resize(options["Hash"], threads, options["SharedHash"]);
+}
+
+void Engine::eval_batch(TimePoint runTime) const {
+    verify_networks();
+    Benchmark::eval_batch(*networks, runTime);
+}
+
+void Engine::accumulator_update(TimePoint runTime) const {
+    verify_networks();
+    Benchmark::accumulator_update(*networks, runTime);
+}
+
+bool Engine::nnue_bench(TimePoint runTime, const std::string& file) const {
+    verify_networks();
+    return Benchmark::nnue_bench(*networks, runTime, file);
+}
+
 void Engine::go(Search::LimitsType& limits) {
     assert(limits.perft == 0);
     verify_networks();
@@ -73,16 +122,192 @@ void Engine::go(Search::LimitsType& limits) {
 
     threads.start_thinking(options, pos, states, limits);
 }
-void Engine::stop() { threads.stop = true; }
+void Engine::stop() {
+    threads.stop = batchStop = true;
+    threads.notify_stop_or_ponderhit();
+}
+
+size_t Engine::batch_group_hash(size_t groups) const {
+    groups = std::clamp(groups, size_t(1), size_t(options["Threads"]));
+    return std::max(size_t(options["Hash"]) / groups, size_t(1));
+}
+
+void Engine::search_batch(size_t                                         groupCount,
+                          const Search::LimitsType&                      limits,
+                          const std::function<bool(std::string&)>&       nextFen,
+                          const std::function<void(const BatchResult&)>& onResult) {
+    assert(limits.perft == 0 && !limits.infinite && !limits.ponderMode);
+    verify_networks();
+    wait_for_search_finished();
+
+    // A group is a complete search: its threads, their hash table and the
+    // position they search. It is kept busy from one position to the next.
+    struct Group {
+        TranspositionTable                   tt;
+        Search::SearchManager::UpdateContext updateContext;
+        ThreadPool                           threads;
+        Position                             pos;
+        StateListPtr                         states;
+        BatchResult                          result;
+    };
+
+    std::mutex              mutex;
+    std::condition_variable cv;
+    std::deque<Group*>      finished;
+    std::deque<std::string> fens;  // Read, but not handed to a group yet
+    bool                    inputEnded = false;
+
+    groupCount = std::clamp(groupCount, size_t(1), size_t(options["Threads"]));
+    batchStop  = false;
+
+    const size_t threadsPerGroup = size_t(options["Threads"]) / groupCount;
+    const size_t mbPerGroup      = batch_group_hash(groupCount);
+
+    std::vector<std::unique_ptr<Group>> groups;
+    std::vector<Group*>                 idle;
+
+    for (size_t i = 0; i < groupCount; ++i)
+    {
+        Group& g = *groups.emplace_back(std::make_unique<Group>());
+        idle.push_back(&g);
+
+        g.updateContext.onUpdateNoMoves = [&g](const InfoShort& info) {
+            g.result.depth = info.depth;
+            g.result.score = info.score;
+        };
+        g.updateContext.onUpdateFull = [&g](const InfoFull& info) {
+            if (info.multiPV != 1)
+                return;
+
+            g.result.depth  = info.depth;
+            g.result.score  = info.score;
+            g.result.nodes  = info.nodes;
+            g.result.timeMs = info.timeMs;
+            g.result.pv     = info.pv;
+        };
+        g.updateContext.onIter     = [](const InfoIter&) {};
+        g.updateContext.onBestmove = [&](std::string_view bestmove, std::string_view) {
+            g.result.bestmove = bestmove;
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                finished.push_back(&g);
+            }
+            cv.notify_one();
+        };
+
+        // The groups are left unbound, binding each of them from the first
+        // NUMA node would crowd the groups on the same processors.
+        g.threads.set(NumaConfig{}, {options, g.threads, g.tt, networks}, g.updateContext,
+                      threadsPerGroup);
+        g.tt.resize(mbPerGroup, g.threads);
+    }
+
+    // The input is read on its own thread, so that the results are reported
+    // and a stop is seen while nextFen waits for the next position.
+    NativeThread reader([&] {
+        std::string fen;
+        bool        more;
+        do
+        {
+            more = nextFen(fen);
+            {
+                std::lock_guard<std::mutex> lk(mutex);
+                if (more)
+                    fens.push_back(fen);
+                else
+                    inputEnded = true;
+            }
+            cv.notify_one();
+        } while (more);
+    });
+
+    size_t nextIndex = 0, running = 0;
+    bool   stopped   = false;
+    auto   start     = [&](Group& g, const std::string& fen) {
+        g.result       = BatchResult{};
+        g.result.index = nextIndex++;
+        g.result.fen   = fen;
+
+        g.states = StateListPtr(new std::deque<StateInfo>(1));
+        g.pos.set(fen, options["UCI_Chess960"], &g.states->back());
+
+        Search::LimitsType groupLimits = limits;
+        groupLimits.startTime          = now();
+        groupLimits.capSq              = SQ_NONE;
+
+        g.threads.start_thinking(options, g.pos, g.states, groupLimits);
+    };
+
+    std::unique_lock<std::mutex> lk(mutex);
+
+    // Hand the positions to the idle groups, until the input is exhausted
+    // and all the searches are done
+    while (true)
+    {
+        while (!finished.empty())
+        {
+            Group* g = finished.front();
+            finished.pop_front();
+
+            lk.unlock();
+            g->threads.main_thread()->wait_for_search_finished();
+            onResult(g->result);
+            lk.lock();
+
+            idle.push_back(g);
+            --running;
+        }
+
+        if (inputEnded && batchStop && !stopped)
+        {
+            stopped = true;
+            fens.clear();
+
+            for (auto&& g : groups)
+            {
+                g->threads.stop = true;
+                g->threads.notify_stop_or_ponderhit();
+            }
+        }
+
+        while (!idle.empty() && !fens.empty())
+        {
+            Group*            g   = idle.back();
+            const std::string fen = fens.front();
+            idle.pop_back();
+            fens.pop_front();
+            ++running;
+
+            lk.unlock();
+            start(*g, fen);
+            lk.lock();
+        }
+
+        if (inputEnded && fens.empty() && !running)
+            break;
+
+        cv.wait(lk, [&] {
+            return !finished.empty() || (!fens.empty() && !idle.empty())
+                || (inputEnded && (!running || (batchStop && !stopped)));
+        });
+    }
+
+    lk.unlock();
+    reader.join();
+}
 
 void Engine::search_clear() {
     wait_for_search_finished();
 
+    const TimePoint start = now();
+
     tt.clear(threads);
     threads.clear();
 
     // @TODO wont work with multiple instances
     Tablebases::init(options["SyzygyPath"]);  // Free mapped files
+
+    searchClearTime = now() - start;
 }
 
 void Engine::set_on_update_no_moves(std::function<void(const Engine::InfoShort&)>&& f) {
@@ -129,6 +354,8 @@ void Engine::set_position(const std::string& fen, const std::vector<std::string>
 // modifiers
 
 void Engine::set_numa_config_from_option(const std::string& o) {
+    std::unique_lock<std::mutex> lk(network_registry().mutex);
+
     if (o == "auto" || o == "system")
     {
         numaContext.set_numa_config(NumaConfig::from_system());
@@ -142,24 +369,63 @@ void Engine::set_numa_config_from_option(const std::string& o) {
         numaContext.set_numa_config(NumaConfig::from_string(o));
     }
 
+    // The networks were replicated again for this engine, use the copies of
+    // another engine with the same config if there are some.
+    if (!share_networks())
+        publish_networks();
+
+    lk.unlock();
+
     // Force reallocation of threads in case affinities need to change.
     resize_threads();
 }
 
 void Engine::resize_threads() {
     threads.wait_for_search_finished();
-    threads.set(numaContext.get_numa_config(), {options, threads, tt, networks}, updateContext);
+    threads.set(numaContext.get_numa_config(), {options, threads, tt, networks}, updateContext,
+                options["Threads"]);
 
-    // Reallocate the hash with the new threadpool size
-    set_tt_size(options["Hash"]);
+    // The hash and its contents are kept, unless its pages have to be placed
+    // on another set of NUMA nodes
+    if (ttNumaNodes != tt_numa_nodes())
+        set_tt_size(options["Hash"]);
+    else
+        tt.set_thread_count(threads.num_threads());
 }
 
 void Engine::set_tt_size(size_t mb) {
     wait_for_search_finished();
-    tt.resize(mb, threads);
+    tt.resize(mb, threads, options["SharedHash"]);
+    ttNumaNodes = tt_numa_nodes();
+}
+
+// The NUMA nodes the threads are bound to, on which clear() places the hash
+std::vector<bool> Engine::tt_numa_nodes() const {
+    std::vector<bool> nodes;
+    for (size_t count : threads.get_bound_thread_count_by_numa_node())
+        nodes.push_back(count > 0);
+    return nodes;
+}
+
+void Engine::set_hot_tt_size(size_t kb) {
+    wait_for_search_finished();
+    threads.resize_hot_tt(kb);
+}
+
+void Engine::save_tt(const std::string& file) {
+    wait_for_search_finished();
+    tt.save_to_file(file);
 }
 
-void Engine::set_ponderhit(bool b) { threads.main_manager()->ponder = b; }
+void Engine::load_tt(const std::string& file) {
+    wait_for_search_finished();
+    tt.load_from_file(file);
+}
+
+void Engine::set_ponderhit(bool b) {
+    threads.main_manager()->ponder = b;
+    threads.notify_stop_or_ponderhit();
+}
 
 // network related
 
@@ -169,30 +435,70 @@ void Engine::verify_networks() const {
 }
 
 void Engine::load_networks() {
-    networks.modify_and_replicate([this](NN::Networks& networks_) {
+    load_shared_networks([this](NN::Networks& networks_) {
         networks_.big.load(binaryDirectory, options["EvalFile"]);
         networks_.small.load(binaryDirectory, options["EvalFileSmall"]);
     });
-    threads.clear();
 }
 
 void Engine::load_big_network(const std::string& file) {
-    networks.modify_and_replicate(
+    load_shared_networks(
       [this, &file](NN::Networks& networks_) { networks_.big.load(binaryDirectory, file); });
-    threads.clear();
 }
 
 void Engine::load_small_network(const std::string& file) {
-    networks.modify_and_replicate(
+    load_shared_networks(
       [this, &file](NN::Networks& networks_) { networks_.small.load(binaryDirectory, file); });
-    threads.clear();
 }
 
 void Engine::save_network(const std::pair<std::optional<std::string>, std::string> files[2]) {
-    networks.modify_and_replicate([&files](NN::Networks& networks_) {
-        networks_.big.save(files[0].first);
-        networks_.small.save(files[1].first);
-    });
+    networks->big.save(files[0].first);
+    networks->small.save(files[1].first);
+}
+
+// Shares the networks of another engine for the files now given by the options,
+// or else loads them with the given function and offers them to the other engines
+void Engine::load_shared_networks(const std::function<void(NN::Networks&)>& load) {
+    {
+        std::lock_guard<std::mutex> lk(network_registry().mutex);
+
+        if (!share_networks())
+        {
+            networks.modify_and_replicate(load);
+            publish_networks();
+        }
+    }
+    threads.clear();
+}
+
+// Key of the networks of this engine in the registry, from the files given by
+// the options and the NUMA config
+std::string Engine::networks_key() const {
+    const NumaConfig& cfg = numaContext.get_numa_config();
+
+    return std::string(options["EvalFile"]) + "|" + std::string(options["EvalFileSmall"]) + "|"
+         + cfg.to_string() + (cfg.requires_memory_replication() ? "|replicated" : "");
+}
+
+// Uses the networks of another engine with the same key, if it is still alive.
+// The caller holds the registry mutex.
+bool Engine::share_networks() {
+    std::vector<std::shared_ptr<NN::Networks>> others;
+
+    for (auto&& replica : network_registry().replicas[networks_key()])
+        if (auto other = replica.lock())
+            others.push_back(std::move(other));
+        else
+            return false;
+
+    return !others.empty() && networks.share(others);
+}
+
+// Offers the networks of this engine to the others. The caller holds the registry mutex.
+void Engine::publish_networks() {
+    auto& replicas = network_registry().replicas[networks_key()];
+
+    replicas.assign(networks.replicas().begin(), networks.replicas().end());
 }
 
 // utility functions
@@ -208,6 +514,7 @@ void Engine::trace_eval() const {
 }
 
 OptionsMap& Engine::get_options() { return options; }
+const OptionsMap& Engine::get_options() const { return options; }
 
 std::string Engine::fen() const { return pos.fen(); }
 
@@ -232,8 +539,30 @@ std::vector<std::pair<size_t, size_t>> Engine::get_bound_thread_count_by_numa_no
     return ratios;
 }
 
+std::vector<std::pair<size_t, size_t>> Engine::get_bound_thread_count_by_capacity() const {
+    return threads.get_bound_thread_count_by_capacity();
+}
+
+TimePoint Engine::get_thread_resize_time() const { return threads.resize_time(); }
+
+TimePoint Engine::get_search_clear_time() const { return searchClearTime; }
+
 std::string Engine::get_numa_config_as_string() const {
     return numaContext.get_numa_config().to_string();
 }
 
+std::string Engine::get_core_classes_as_string() const {
+    return numaContext.get_numa_config().core_classes_to_string();
+}
+
+std::vector<size_t> Engine::get_tt_page_count_by_numa_node() const {
+    return tt.page_count_by_numa_node();
+}
+
+TimePoint Engine::get_tt_allocation_time() const { return tt.allocation_time(); }
+
+TTProbeStats Engine::get_tt_probe_stats() const { return threads.tt_probe_stats(); }
+
+std::vector<Search::SearchStats> Engine::get_search_stats() const { return threads.search_stats(); }
+
 }
@@ -19,9 +19,11 @@
 #ifndef ENGINE_H_INCLUDED
 #define ENGINE_H_INCLUDED
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -30,6 +32,7 @@
 
 #include "nnue/network.h"
 #include "position.h"
+#include "score.h"
 #include "search.h"
 #include "syzygy/tbprobe.h"  // for Stockfish::Depth
 #include "thread.h"
@@ -42,11 +45,24 @@ namespace Stockfish {
 enum Square : int;
 
 class Engine {
+    struct AsyncRequest;
+
    public:
     using InfoShort = Search::InfoShort;
     using InfoFull  = Search::InfoFull;
     using InfoIter  = Search::InfoIteration;
 
+    struct BatchResult {
+        size_t      index;  // Position of the FEN in the batch, counted from 0
+        std::string fen;
+        int         depth = 0;
+        Score       score;
+        size_t      nodes  = 0;
+        size_t      timeMs = 0;
+        std::string pv;
+        std::string bestmove;
+    };
+
     Engine(std::string path = "");
 
     // Can't be movable due to components holding backreferences to fields
@@ -55,15 +71,35 @@ class Engine {
     Engine& operator=(const Engine&) = delete;
     Engine& operator=(Engine&&)      = delete;
 
-    ~Engine() { wait_for_search_finished(); }
+    ~Engine();
 
     std::uint64_t perft(const std::string& fen, Depth depth, bool isChess960);
+    void          tt_stress(size_t maxThreads, TimePoint runTime, size_t mb);
+    void          eval_batch(TimePoint runTime) const;
+    void          accumulator_update(TimePoint runTime) const;
+    bool          nnue_bench(TimePoint runTime, const std::string& file) const;
 
     // non blocking call to start searching
     void go(Search::LimitsType&);
     // non blocking call to stop searching
     void stop();
 
+    // blocking call to search the positions returned by nextFen, until it
+    // returns false, with the given limits. The Threads and Hash budgets are
+    // split among groups of threads with their own pools and hash tables,
+    // which search different positions concurrently. Results are passed to
+    // onResult as soon as they are available, so not always in input order.
+    // nextFen is called on a thread of its own and may block. If stop() is
+    // called, the running searches are stopped once nextFen returns false and
+    // the positions not started yet are dropped.
+    void search_batch(size_t                                         groups,
+                      const Search::LimitsType&                      limits,
+                      const std::function<bool(std::string&)>&       nextFen,
+                      const std::function<void(const BatchResult&)>& onResult);
+    // The hash table size of each group of search_batch(), in MB. The groups
+    // allocate it in addition to the hash table of the engine, which is kept.
+    size_t batch_group_hash(size_t groups) const;
+
     // blocking call to wait for search to finish
     void wait_for_search_finished();
     // set a new position, moves are in UCI format
@@ -74,6 +110,9 @@ class Engine {
     void set_numa_config_from_option(const std::string& o);
     void resize_threads();
     void set_tt_size(size_t mb);
+    void set_hot_tt_size(size_t kb);
+    void save_tt(const std::string& file);
+    void load_tt(const std::string& file);
     void set_ponderhit(bool);
     void search_clear();
 
@@ -94,11 +133,20 @@ class Engine {
 
     void                                   trace_eval() const;
     OptionsMap&                            get_options();
+    const OptionsMap&                      get_options() const;
     std::string                            fen() const;
     void                                   flip();
     std::string                            visualize() const;
     std::vector<std::pair<size_t, size_t>> get_bound_thread_count_by_numa_node() const;
+    std::vector<std::pair<size_t, size_t>> get_bound_thread_count_by_capacity() const;
+    TimePoint                              get_thread_resize_time() const;
+    TimePoint                              get_search_clear_time() const;
     std::string                            get_numa_config_as_string() const;
+    std::string                            get_core_classes_as_string() const;
+    std::vector<size_t>                    get_tt_page_count_by_numa_node() const;
+    TimePoint                              get_tt_allocation_time() const;
+    TTProbeStats                           get_tt_probe_stats() const;
+    std::vector<Search::SearchStats>       get_search_stats() const;
 
    private:
     const std::string binaryDirectory;
@@ -115,6 +163,20 @@ class Engine {
     NumaReplicated<Eval::NNUE::Networks> networks;
 
     Search::SearchManager::UpdateContext updateContext;
+
+    TimePoint searchClearTime = 0;
+
+    std::atomic_bool batchStop = false;  // Set by stop() during search_batch()
+
+    // The NUMA nodes of the threads when the hash was last allocated
+    std::optional<std::vector<bool>> ttNumaNodes;
+
+    void        load_shared_networks(const std::function<void(Eval::NNUE::Networks&)>& load);
+    std::string networks_key() const;
+    bool        share_networks();
+    void        publish_networks();
+
+    std::vector<bool> tt_numa_nodes() const;
 };
 
 }  // namespace Stockfish
@@ -38,7 +38,5 @@ int main(int argc, char* argv[]) {
 
     Tune::init(uci.engine_options());
 
-    uci.loop();
-
-    return 0;
+    return uci.loop();
 }
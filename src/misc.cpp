@@ -271,6 +271,9 @@ std::string compiler_info() {
 #if defined(USE_VNNI)
     compiler += " VNNI";
 #endif
+#if defined(USE_AVX512ICL)
+    compiler += " AVX512ICL";
+#endif
 #if defined(USE_AVX512)
     compiler += " AVX512";
 #endif
@@ -593,6 +596,12 @@ void aligned_large_pages_free(void* mem) { std_aligned_free(mem); }
 
 #endif
 
+void large_page_alloc_failed(size_t size) {
+
+    std::cerr << "Failed to allocate " << size << " bytes of large page memory" << std::endl;
+    exit(EXIT_FAILURE);
+}
+
 
 #ifdef _WIN32
     #include <direct.h>
@@ -27,7 +27,9 @@
 #include <cstdio>
 #include <iosfwd>
 #include <memory>
+#include <new>
 #include <string>
+#include <utility>
 #include <vector>
 #include <optional>
 
@@ -51,6 +53,8 @@ void  std_aligned_free(void* ptr);
 void* aligned_large_pages_alloc(size_t size);
 // nop if mem == nullptr
 void aligned_large_pages_free(void* mem);
+// Reports that size bytes of large page memory could not be allocated and exits
+[[noreturn]] void large_page_alloc_failed(size_t size);
 
 size_t str_to_size_t(const std::string& s);
 
@@ -77,6 +81,22 @@ using AlignedPtr = std::unique_ptr<T, AlignedDeleter<T>>;
 template<typename T>
 using LargePagePtr = std::unique_ptr<T, LargePageDeleter<T>>;
 
+// Constructs an object of type T in memory from aligned_large_pages_alloc(). As
+// the calling thread touches the memory first, on NUMA systems it is placed on
+// the node that thread runs on.
+template<typename T, typename... Args>
+LargePagePtr<T> make_unique_large_page(Args&&... args) {
+
+    static_assert(alignof(T) <= 4096,
+                  "aligned_large_pages_alloc() may fail for such a big alignment requirement of T");
+
+    void* mem = aligned_large_pages_alloc(sizeof(T));
+    if (!mem)
+        large_page_alloc_failed(sizeof(T));
+
+    return LargePagePtr<T>(new (mem) T(std::forward<Args>(args)...));
+}
+
 struct PipeDeleter {
     void operator()(FILE* file) const {
         if (file != nullptr)
@@ -109,6 +129,15 @@ void dbg_stdev_of(int64_t value, int slot = 0);
 void dbg_correl_of(int64_t value1, int64_t value2, int slot = 0);
 void dbg_print();
 
+// Per-thread search statistics are only collected when built with
+// 'make searchstats=yes'. Otherwise the code updating them is discarded
+// through 'if constexpr' and the instrumentation costs nothing.
+#ifdef SEARCH_STATS
+constexpr bool SearchStatsEnabled = true;
+#else
+constexpr bool SearchStatsEnabled = false;
+#endif
+
 using TimePoint = std::chrono::milliseconds::rep;  // A value in milliseconds
 static_assert(sizeof(TimePoint) == sizeof(int64_t), "TimePoint should be 64 bits");
 inline TimePoint now() {
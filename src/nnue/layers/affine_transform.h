@@ -21,6 +21,7 @@
 #ifndef NNUE_LAYERS_AFFINE_TRANSFORM_H_INCLUDED
 #define NNUE_LAYERS_AFFINE_TRANSFORM_H_INCLUDED
 
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 
@@ -295,7 +296,99 @@ class AffineTransform {
 #endif
     }
 
+    // Forward propagation of count inputs stored one after the other, with the
+    // outputs stored likewise. The inputs are processed in tiles, and each weight
+    // column is loaded once for all the inputs of a tile.
+    void propagate_batch(const InputType* input, OutputType* output, IndexType count) const {
+
+        IndexType b = 0;
+
+#if defined(USE_SSSE3)
+        if constexpr (BatchTile >= 8)
+            for (; count - b >= 8; b += 8)
+                propagate_tile<8>(input + b * PaddedInputDimensions,
+                                  output + b * PaddedOutputDimensions);
+
+        if constexpr (BatchTile >= 4)
+            for (; count - b >= 4; b += 4)
+                propagate_tile<4>(input + b * PaddedInputDimensions,
+                                  output + b * PaddedOutputDimensions);
+
+        if constexpr (BatchTile >= 2)
+            for (; count - b >= 2; b += 2)
+                propagate_tile<2>(input + b * PaddedInputDimensions,
+                                  output + b * PaddedOutputDimensions);
+#endif
+
+        for (; b < count; ++b)
+            propagate(input + b * PaddedInputDimensions, output + b * PaddedOutputDimensions);
+    }
+
    private:
+    // Inputs of a tile in propagate_batch(), their sums taking up to 8 registers.
+    // The single output layer reads only one register of weights and is not tiled.
+    static constexpr IndexType BatchTile =
+      OutputDimensions > 1
+        ? std::max<IndexType>(1, 8 * Simd::RegisterBytes / (OutputDimensions * sizeof(OutputType)))
+        : 1;
+
+#if defined(USE_SSSE3)
+    template<IndexType Tile>
+    void propagate_tile(const InputType* input, OutputType* output) const {
+
+    #if defined(USE_AVX512)
+        using vec_t = __m512i;
+        #define vec_set_32 _mm512_set1_epi32
+        #define vec_add_dpbusd_32 Simd::m512_add_dpbusd_epi32
+    #elif defined(USE_AVX2)
+        using vec_t = __m256i;
+        #define vec_set_32 _mm256_set1_epi32
+        #define vec_add_dpbusd_32 Simd::m256_add_dpbusd_epi32
+    #elif defined(USE_SSSE3)
+        using vec_t = __m128i;
+        #define vec_set_32 _mm_set1_epi32
+        #define vec_add_dpbusd_32 Simd::m128_add_dpbusd_epi32
+    #endif
+
+        static constexpr IndexType OutputSimdWidth = sizeof(vec_t) / sizeof(OutputType);
+
+        static_assert(OutputDimensions % OutputSimdWidth == 0);
+
+        constexpr IndexType NumChunks   = ceil_to_multiple<IndexType>(InputDimensions, 8) / 4;
+        constexpr IndexType NumRegs     = OutputDimensions / OutputSimdWidth;
+        constexpr IndexType InputStride = PaddedInputDimensions / 4;
+
+        const auto   input32 = reinterpret_cast<const std::int32_t*>(input);
+        const vec_t* biasvec = reinterpret_cast<const vec_t*>(biases);
+        vec_t        acc[Tile][NumRegs];
+        for (IndexType b = 0; b < Tile; ++b)
+            for (IndexType k = 0; k < NumRegs; ++k)
+                acc[b][k] = biasvec[k];
+
+        for (IndexType i = 0; i < NumChunks; ++i)
+        {
+            const auto col0 = reinterpret_cast<const vec_t*>(&weights[i * OutputDimensions * 4]);
+
+            for (IndexType b = 0; b < Tile; ++b)
+            {
+                const vec_t in0 = vec_set_32(input32[b * InputStride + i]);
+                for (IndexType k = 0; k < NumRegs; ++k)
+                    vec_add_dpbusd_32(acc[b][k], in0, col0[k]);
+            }
+        }
+
+        for (IndexType b = 0; b < Tile; ++b)
+        {
+            vec_t* outptr = reinterpret_cast<vec_t*>(output + b * PaddedOutputDimensions);
+            for (IndexType k = 0; k < NumRegs; ++k)
+                outptr[k] = acc[b][k];
+        }
+
+    #undef vec_set_32
+    #undef vec_add_dpbusd_32
+    }
+#endif
+
     using BiasType   = OutputType;
     using WeightType = std::int8_t;
 
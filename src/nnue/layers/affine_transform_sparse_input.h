@@ -24,6 +24,7 @@
 #include <algorithm>
 #include <array>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 
 #include "../../bitboard.h"
@@ -128,6 +129,40 @@ void find_nnz(const std::int32_t* input, std::uint16_t* out, IndexType& count_ou
     #undef vec128_add
 #endif
 
+#if defined(USE_AVX512ICL)
+// Find indices of nonzero numbers in an int32_t array with vpcompressw, 32 at a
+// time, instead of the lookup table of find_nnz(). Up to 32 indices are stored
+// past the last one found, so out must have room for InputDimensions of them.
+template<const IndexType InputDimensions>
+void find_nnz_compress(const std::int32_t* input, std::uint16_t* out, IndexType& count_out) {
+
+    static_assert(InputDimensions % 32 == 0);
+
+    constexpr IndexType NumChunks = InputDimensions / 32;
+
+    const auto    inputVector = reinterpret_cast<const __m512i*>(input);
+    const __m512i increment   = _mm512_set1_epi16(32);
+    __m512i base = _mm512_set_epi16(31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16,
+                                    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    IndexType count = 0;
+
+    for (IndexType i = 0; i < NumChunks; ++i)
+    {
+        // Bitmask of the values greater than zero, like find_nnz()
+        const __mmask32 nnz =
+          _mm512_kunpackw(_mm512_cmpgt_epi32_mask(inputVector[2 * i + 1], _mm512_setzero_si512()),
+                          _mm512_cmpgt_epi32_mask(inputVector[2 * i], _mm512_setzero_si512()));
+
+        // Compress into a register and store it whole, as the compressing store
+        // to memory is microcoded on some processors.
+        _mm512_storeu_si512(out + count, _mm512_maskz_compress_epi16(nnz, base));
+        count += popcount(nnz);
+        base = _mm512_add_epi16(base, increment);
+    }
+    count_out = count;
+}
+#endif
+
 // Sparse input implementation
 template<IndexType InDims, IndexType OutDims>
 class AffineTransformSparseInput {
@@ -198,6 +233,16 @@ class AffineTransformSparseInput {
     }
     // Forward propagation
     void propagate(const InputType* input, OutputType* output) const {
+#if defined(USE_AVX512ICL)
+        propagate_avx512icl(input, output);
+#else
+        propagate_generic(input, output);
+#endif
+    }
+
+    // Forward propagation shared by all the architectures. On AVX512ICL builds
+    // propagate() uses its own kernel, this one is then kept as the reference.
+    void propagate_generic(const InputType* input, OutputType* output) const {
 
 #if (USE_SSSE3 | (USE_NEON >= 8))
     #if defined(USE_AVX512)
@@ -265,7 +310,187 @@ class AffineTransformSparseInput {
 #endif
     }
 
+#if defined(USE_AVX512ICL)
+    // Forward propagation for processors with AVX-512 VNNI and VBMI2, like Ice
+    // Lake, Sapphire Rapids or Zen 4. The nonzero blocks are found by
+    // find_nnz_compress(), and consecutive ones are summed with vpdpbusd into
+    // NumSums separate registers, so that the latency of each vpdpbusd does not
+    // hold up the next. The sums of 32-bit integers wrap around and do not depend
+    // on their order, so that the output is exactly that of propagate_generic().
+    void propagate_avx512icl(const InputType* input, OutputType* output) const {
+
+        constexpr IndexType NumChunks = ceil_to_multiple<IndexType>(InputDimensions, 8) / ChunkSize;
+        constexpr IndexType NumRegs   = OutputDimensions / 16;
+        constexpr IndexType NumSums   = std::max<IndexType>(1, 4 / NumRegs);
+        std::uint16_t       nnz[NumChunks];
+        IndexType           count;
+
+        const auto input32 = reinterpret_cast<const std::int32_t*>(input);
+
+        find_nnz_compress<NumChunks>(input32, nnz, count);
+
+        const __m512i* biasvec = reinterpret_cast<const __m512i*>(biases);
+        __m512i        acc[NumSums][NumRegs];
+        for (IndexType k = 0; k < NumRegs; ++k)
+        {
+            acc[0][k] = biasvec[k];
+            for (IndexType s = 1; s < NumSums; ++s)
+                acc[s][k] = _mm512_setzero_si512();
+        }
+
+        IndexType j = 0;
+        for (; j + NumSums <= count; j += NumSums)
+            for (IndexType s = 0; s < NumSums; ++s)
+            {
+                const auto    i  = nnz[j + s];
+                const __m512i in = _mm512_set1_epi32(input32[i]);
+                const auto    col =
+                  reinterpret_cast<const __m512i*>(&weights[i * OutputDimensions * ChunkSize]);
+                for (IndexType k = 0; k < NumRegs; ++k)
+                    acc[s][k] = _mm512_dpbusd_epi32(acc[s][k], in, col[k]);
+            }
+
+        for (; j < count; ++j)
+        {
+            const auto    i  = nnz[j];
+            const __m512i in = _mm512_set1_epi32(input32[i]);
+            const auto    col =
+              reinterpret_cast<const __m512i*>(&weights[i * OutputDimensions * ChunkSize]);
+            for (IndexType k = 0; k < NumRegs; ++k)
+                acc[0][k] = _mm512_dpbusd_epi32(acc[0][k], in, col[k]);
+        }
+
+        __m512i* outptr = reinterpret_cast<__m512i*>(output);
+        for (IndexType k = 0; k < NumRegs; ++k)
+        {
+            for (IndexType s = 1; s < NumSums; ++s)
+                acc[0][k] = _mm512_add_epi32(acc[0][k], acc[s][k]);
+            outptr[k] = acc[0][k];
+        }
+    }
+#endif
+
+    // Forward propagation of count inputs stored one after the other, with the
+    // outputs stored likewise. The inputs are processed in tiles: the union of
+    // the nonzero blocks of a tile is found once, and each weight column is then
+    // loaded once for all the inputs of the tile. A block which is zero for an
+    // input adds nothing to its sums, so the outputs are those of propagate().
+    void propagate_batch(const InputType* input, OutputType* output, IndexType count) const {
+
+        IndexType b = 0;
+
+#if (USE_SSSE3 | (USE_NEON >= 8))
+        if constexpr (BatchTile >= 8)
+            for (; count - b >= 8; b += 8)
+                propagate_tile<8>(input + b * PaddedInputDimensions,
+                                  output + b * PaddedOutputDimensions);
+
+        if constexpr (BatchTile >= 4)
+            for (; count - b >= 4; b += 4)
+                propagate_tile<4>(input + b * PaddedInputDimensions,
+                                  output + b * PaddedOutputDimensions);
+
+        if constexpr (BatchTile >= 2)
+            for (; count - b >= 2; b += 2)
+                propagate_tile<2>(input + b * PaddedInputDimensions,
+                                  output + b * PaddedOutputDimensions);
+#endif
+
+        for (; b < count; ++b)
+            propagate(input + b * PaddedInputDimensions, output + b * PaddedOutputDimensions);
+    }
+
    private:
+    // Inputs of a tile in propagate_batch(), their sums taking up to 8 registers
+    static constexpr IndexType BatchTile = std::max<IndexType>(
+      1, 8 * Simd::RegisterBytes / (OutputDimensions * sizeof(OutputType)));
+
+#if (USE_SSSE3 | (USE_NEON >= 8))
+    template<IndexType Tile>
+    void propagate_tile(const InputType* input, OutputType* output) const {
+
+    #if defined(USE_AVX512)
+        using invec_t  = __m512i;
+        using outvec_t = __m512i;
+        #define vec_set_32 _mm512_set1_epi32
+        #define vec_add_dpbusd_32 Simd::m512_add_dpbusd_epi32
+    #elif defined(USE_AVX2)
+        using invec_t  = __m256i;
+        using outvec_t = __m256i;
+        #define vec_set_32 _mm256_set1_epi32
+        #define vec_add_dpbusd_32 Simd::m256_add_dpbusd_epi32
+    #elif defined(USE_SSSE3)
+        using invec_t  = __m128i;
+        using outvec_t = __m128i;
+        #define vec_set_32 _mm_set1_epi32
+        #define vec_add_dpbusd_32 Simd::m128_add_dpbusd_epi32
+    #elif defined(USE_NEON_DOTPROD)
+        using invec_t  = int8x16_t;
+        using outvec_t = int32x4_t;
+        #define vec_set_32(a) vreinterpretq_s8_u32(vdupq_n_u32(a))
+        #define vec_add_dpbusd_32 Simd::dotprod_m128_add_dpbusd_epi32
+    #elif defined(USE_NEON)
+        using invec_t  = int8x16_t;
+        using outvec_t = int32x4_t;
+        #define vec_set_32(a) vreinterpretq_s8_u32(vdupq_n_u32(a))
+        #define vec_add_dpbusd_32 Simd::neon_m128_add_dpbusd_epi32
+    #endif
+        static constexpr IndexType OutputSimdWidth = sizeof(outvec_t) / sizeof(OutputType);
+
+        constexpr IndexType NumChunks = ceil_to_multiple<IndexType>(InputDimensions, 8) / ChunkSize;
+        constexpr IndexType NumRegs   = OutputDimensions / OutputSimdWidth;
+        constexpr IndexType InputStride = PaddedInputDimensions / ChunkSize;
+        std::uint16_t       nnz[NumChunks];
+        IndexType           count;
+
+        const auto input32 = reinterpret_cast<const std::int32_t*>(input);
+
+    #if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+        std::int32_t blocksUnaligned[NumChunks + CacheLineSize / sizeof(std::int32_t)];
+        auto*        blocks = align_ptr_up<CacheLineSize>(&blocksUnaligned[0]);
+    #else
+        alignas(CacheLineSize) std::int32_t blocks[NumChunks];
+    #endif
+
+        // Find indices of the 32-bit blocks that are nonzero in any input
+        std::memcpy(blocks, input32, sizeof(std::int32_t) * NumChunks);
+        for (IndexType b = 1; b < Tile; ++b)
+            for (IndexType i = 0; i < NumChunks; ++i)
+                blocks[i] |= input32[b * InputStride + i];
+
+        find_nnz<NumChunks>(blocks, nnz, count);
+
+        const outvec_t* biasvec = reinterpret_cast<const outvec_t*>(biases);
+        outvec_t        acc[Tile][NumRegs];
+        for (IndexType b = 0; b < Tile; ++b)
+            for (IndexType k = 0; k < NumRegs; ++k)
+                acc[b][k] = biasvec[k];
+
+        for (IndexType j = 0; j < count; ++j)
+        {
+            const auto i = nnz[j];
+            const auto col =
+              reinterpret_cast<const invec_t*>(&weights[i * OutputDimensions * ChunkSize]);
+
+            for (IndexType b = 0; b < Tile; ++b)
+            {
+                const invec_t in = vec_set_32(input32[b * InputStride + i]);
+                for (IndexType k = 0; k < NumRegs; ++k)
+                    vec_add_dpbusd_32(acc[b][k], in, col[k]);
+            }
+        }
+
+        for (IndexType b = 0; b < Tile; ++b)
+        {
+            outvec_t* outptr = reinterpret_cast<outvec_t*>(output + b * PaddedOutputDimensions);
+            for (IndexType k = 0; k < NumRegs; ++k)
+                outptr[k] = acc[b][k];
+        }
+    #undef vec_set_32
+    #undef vec_add_dpbusd_32
+    }
+#endif
+
     using BiasType   = OutputType;
     using WeightType = std::int8_t;
 
@@ -37,6 +37,15 @@
 
 namespace Stockfish::Simd {
 
+// Size in bytes of the widest vector registers used by the affine layers
+#if defined(USE_AVX512)
+constexpr int RegisterBytes = 64;
+#elif defined(USE_AVX2)
+constexpr int RegisterBytes = 32;
+#else
+constexpr int RegisterBytes = 16;
+#endif
+
 #if defined(USE_AVX512)
 
 [[maybe_unused]] static int m512_hadd(__m512i sum, int bias) {
@@ -18,6 +18,7 @@
 
 #include "network.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
@@ -267,6 +268,75 @@ Value Network<Arch, Transformer>::evaluate(const Position&
 }
 
 
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::evaluate_batch(const Position* const*                  positions,
+                                                size_t                                  count,
+                                                AccumulatorCaches::Cache<FTDimensions>* cache,
+                                                Value*                                  values,
+                                                bool adjusted) const {
+
+    constexpr uint64_t  alignment = CacheLineSize;
+    constexpr int       delta     = 24;
+    constexpr IndexType Stride    = FeatureTransformer<FTDimensions, nullptr>::BufferSize;
+
+#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+    TransformedFeatureType
+      transformedFeaturesUnaligned[MaxBatchSize * Stride
+                                   + alignment / sizeof(TransformedFeatureType)];
+
+    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
+#else
+    alignas(alignment) TransformedFeatureType transformedFeatures[MaxBatchSize * Stride];
+#endif
+
+    ASSERT_ALIGNED(transformedFeatures, alignment);
+
+    for (size_t start = 0; start < count; start += MaxBatchSize)
+    {
+        const auto n = IndexType(std::min<size_t>(MaxBatchSize, count - start));
+
+        IndexType    order[MaxBatchSize];
+        int          bucket[MaxBatchSize];
+        std::int32_t psqt[MaxBatchSize], positional[MaxBatchSize];
+
+        // Order the positions by layer stack, so that each stack gets one batch
+        for (IndexType i = 0; i < n; ++i)
+        {
+            order[i]  = i;
+            bucket[i] = (positions[start + i]->count<ALL_PIECES>() - 1) / 4;
+        }
+
+        std::stable_sort(order, order + n,
+                         [&](IndexType a, IndexType b) { return bucket[a] < bucket[b]; });
+
+        for (IndexType i = 0; i < n; ++i)
+            psqt[i] = featureTransformer->transform(*positions[start + order[i]], cache,
+                                                    transformedFeatures + i * Stride,
+                                                    bucket[order[i]]);
+
+        for (IndexType i = 0, j; i < n; i = j)
+        {
+            for (j = i + 1; j < n && bucket[order[j]] == bucket[order[i]]; ++j)
+            {}
+
+            network[bucket[order[i]]]->propagate_batch(transformedFeatures + i * Stride, j - i,
+                                                       positional + i);
+        }
+
+        // Give more value to positional evaluation when adjusted flag is set
+        for (IndexType i = 0; i < n; ++i)
+        {
+            const std::int32_t p = psqt[i], q = positional[i];
+
+            values[start + order[i]] =
+              adjusted ? static_cast<Value>(((1024 - delta) * p + (1024 + delta) * q)
+                                            / (1024 * OutputScale))
+                       : static_cast<Value>((p + q) / OutputScale);
+        }
+    }
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::verify(std::string evalfilePath) const {
     if (evalfilePath.empty())
@@ -300,6 +370,12 @@ void Network<Arch, Transformer>::verify(std::string evalfilePath) const {
 }
 
 
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::update_accumulators(
+  const Position& pos, AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    featureTransformer->update_accumulators(pos, cache);
+}
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::hint_common_access(
   const Position& pos, AccumulatorCaches::Cache<FTDimensions>* cache) const {
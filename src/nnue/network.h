@@ -19,6 +19,7 @@
 #ifndef NETWORK_H_INCLUDED
 #define NETWORK_H_INCLUDED
 
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <optional>
@@ -64,10 +65,23 @@ class Network {
                    bool                                    adjusted   = false,
                    int*                                    complexity = nullptr) const;
 
+    // Evaluates count positions, like evaluate() would do one by one, with the
+    // affine layers of the positions sharing a layer stack computed together.
+    void evaluate_batch(const Position* const*                  positions,
+                        size_t                                  count,
+                        AccumulatorCaches::Cache<FTDimensions>* cache,
+                        Value*                                  values,
+                        bool                                    adjusted = false) const;
 
+    void update_accumulators(const Position&                         pos,
+                             AccumulatorCaches::Cache<FTDimensions>* cache) const;
     void hint_common_access(const Position&                         pos,
                             AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
+    // The parts of the network, for the inference microbenchmarks
+    const Transformer& feature_transformer() const { return *featureTransformer; }
+    const Arch&        layer_stack(int bucket) const { return *network[bucket]; }
+
     void          verify(std::string evalfilePath) const;
     NnueEvalTrace trace_evaluate(const Position&                         pos,
                                  AccumulatorCaches::Cache<FTDimensions>* cache) const;
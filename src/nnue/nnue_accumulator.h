@@ -38,6 +38,7 @@ struct alignas(CacheLineSize) Accumulator {
     std::int16_t accumulation[COLOR_NB][Size];
     std::int32_t psqtAccumulation[COLOR_NB][PSQTBuckets];
     bool         computed[COLOR_NB];
+    bool         hinted[COLOR_NB];  // Common parent, updated when a child is evaluated
 };
 
 
@@ -78,6 +79,8 @@ struct AccumulatorCaches {
             for (auto& entries1D : entries)
                 for (auto& entry : entries1D)
                     entry.clear(network.featureTransformer->biases);
+
+            refreshes = updates = deferred = deferredComputed = 0;
         }
 
         void clear(const BiasType* biases) {
@@ -88,6 +91,11 @@ struct AccumulatorCaches {
         std::array<Entry, COLOR_NB>& operator[](Square sq) { return entries[sq]; }
 
         std::array<std::array<Entry, COLOR_NB>, SQUARE_NB> entries;
+
+        // Accumulator refreshes and incremental updates, and the accumulators
+        // of hinted common parents and how many of them got computed at last.
+        // Only counted when SearchStatsEnabled.
+        uint64_t refreshes = 0, updates = 0, deferred = 0, deferredComputed = 0;
     };
 
     template<typename Networks>
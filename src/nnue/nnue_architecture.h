@@ -21,6 +21,7 @@
 #ifndef NNUE_ARCHITECTURE_H_INCLUDED
 #define NNUE_ARCHITECTURE_H_INCLUDED
 
+#include <cassert>
 #include <cstdint>
 #include <cstring>
 #include <iosfwd>
@@ -49,6 +50,9 @@ constexpr int       L3Small                           = 32;
 constexpr IndexType PSQTBuckets = 8;
 constexpr IndexType LayerStacks = 8;
 
+// Maximum number of positions propagated at once by propagate_batch()
+constexpr IndexType MaxBatchSize = 16;
+
 template<IndexType L1, int L2, int L3>
 struct NetworkArchitecture {
     static constexpr IndexType TransformedFeatureDimensions = L1;
@@ -130,6 +134,62 @@ struct NetworkArchitecture {
 
         return outputValue;
     }
+
+    // Propagates count transformed feature vectors stored one after the other,
+    // at most MaxBatchSize. The affine layers are computed for the whole batch,
+    // so that their weights are loaded once per tile of positions instead of
+    // once per position. The results are exactly those of propagate().
+    void propagate_batch(const TransformedFeatureType* transformedFeatures,
+                         IndexType                     count,
+                         std::int32_t*                 outputs) {
+        struct alignas(CacheLineSize) BatchBuffer {
+            alignas(CacheLineSize) typename decltype(fc_0)::OutputBuffer fc_0_out[MaxBatchSize];
+            alignas(CacheLineSize) typename decltype(ac_sqr_0)::OutputType
+              ac_sqr_0_out[MaxBatchSize][ceil_to_multiple<IndexType>(FC_0_OUTPUTS * 2, 32)];
+            alignas(CacheLineSize) typename decltype(ac_0)::OutputBuffer ac_0_out[MaxBatchSize];
+            alignas(CacheLineSize) typename decltype(fc_1)::OutputBuffer fc_1_out[MaxBatchSize];
+            alignas(CacheLineSize) typename decltype(ac_1)::OutputBuffer ac_1_out[MaxBatchSize];
+            alignas(CacheLineSize) typename decltype(fc_2)::OutputBuffer fc_2_out[MaxBatchSize];
+
+            BatchBuffer() { std::memset(this, 0, sizeof(*this)); }
+        };
+
+        static_assert(sizeof(BatchBuffer::ac_sqr_0_out[0])
+                      == decltype(fc_1)::PaddedInputDimensions);
+        assert(count <= MaxBatchSize);
+
+#if defined(__clang__) && (__APPLE__)
+        // workaround for a bug reported with xcode 12
+        static thread_local auto tlsBuffer = std::make_unique<BatchBuffer>();
+        // Access TLS only once, cache result.
+        BatchBuffer& buffer = *tlsBuffer;
+#else
+        alignas(CacheLineSize) static thread_local BatchBuffer buffer;
+#endif
+
+        fc_0.propagate_batch(transformedFeatures, buffer.fc_0_out[0], count);
+
+        for (IndexType b = 0; b < count; ++b)
+        {
+            ac_sqr_0.propagate(buffer.fc_0_out[b], buffer.ac_sqr_0_out[b]);
+            ac_0.propagate(buffer.fc_0_out[b], buffer.ac_0_out[b]);
+            std::memcpy(buffer.ac_sqr_0_out[b] + FC_0_OUTPUTS, buffer.ac_0_out[b],
+                        FC_0_OUTPUTS * sizeof(typename decltype(ac_0)::OutputType));
+        }
+
+        fc_1.propagate_batch(buffer.ac_sqr_0_out[0], buffer.fc_1_out[0], count);
+
+        for (IndexType b = 0; b < count; ++b)
+            ac_1.propagate(buffer.fc_1_out[b], buffer.ac_1_out[b]);
+
+        fc_2.propagate_batch(buffer.ac_1_out[0], buffer.fc_2_out[0], count);
+
+        // See propagate() for the scaling of the forwarded output
+        for (IndexType b = 0; b < count; ++b)
+            outputs[b] = buffer.fc_2_out[b][0]
+                       + (buffer.fc_0_out[b][FC_0_OUTPUTS]) * (600 * OutputScale)
+                           / (127 * (1 << WeightScaleBits));
+    }
 };
 
 }  // namespace Stockfish::Eval::NNUE
@@ -28,6 +28,7 @@
 #include <iosfwd>
 #include <utility>
 
+#include "../misc.h"
 #include "../position.h"
 #include "../types.h"
 #include "nnue_accumulator.h"
@@ -323,8 +324,7 @@ class FeatureTransformer {
                            AccumulatorCaches::Cache<HalfDimensions>* cache,
                            OutputType*                               output,
                            int                                       bucket) const {
-        update_accumulator<WHITE>(pos, cache);
-        update_accumulator<BLACK>(pos, cache);
+        update_accumulators(pos, cache);
 
         const Color perspectives[2]  = {pos.side_to_move(), ~pos.side_to_move()};
         const auto& psqtAccumulation = (pos.state()->*accPtr).psqtAccumulation;
@@ -398,6 +398,13 @@ class FeatureTransformer {
         return psqt;
     }  // end of function transform()
 
+    // Computes the accumulators of pos, as done by transform()
+    void update_accumulators(const Position&                           pos,
+                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
+        update_accumulator<WHITE>(pos, cache);
+        update_accumulator<BLACK>(pos, cache);
+    }
+
     void hint_common_access(const Position&                           pos,
                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
         hint_common_access_for_perspective<WHITE>(pos, cache);
@@ -410,6 +417,8 @@ class FeatureTransformer {
     try_find_computed_accumulator(const Position& pos) const {
         // Look for a usable accumulator of an earlier position. We keep track
         // of the estimated gain in terms of features to be added/subtracted.
+        // The cost is charged on every ply, also past a hinted accumulator, as
+        // it bounds the number of features gathered by the incremental update.
         StateInfo *st = pos.state(), *next = nullptr;
         int        gain = FeatureSet::refresh_cost(pos);
         while (st->previous && !(st->*accPtr).computed[Perspective])
@@ -425,6 +434,40 @@ class FeatureTransformer {
         return {st, next};
     }
 
+    // Drops the features that are both removed and added over several plies,
+    // like the squares a piece only passed through. Their columns cancel out,
+    // so that the whole delta is applied in one pass without reading them.
+    static void cancel_common_indices(FeatureSet::IndexList& removed,
+                                      FeatureSet::IndexList& added) {
+        assert(removed.size() <= FeatureSet::MaxActiveDimensions
+               && added.size() <= FeatureSet::MaxActiveDimensions);
+
+        FeatureSet::IndexList remaining;
+        bool                  cancelled[FeatureSet::MaxActiveDimensions] = {};
+
+        for (const auto index : removed)
+        {
+            std::size_t k = 0;
+            while (k < added.size() && (cancelled[k] || added[k] != index))
+                ++k;
+
+            if (k < added.size())
+                cancelled[k] = true;
+            else
+                remaining.push_back(index);
+        }
+
+        if (remaining.size() == removed.size())
+            return;
+
+        removed   = remaining;
+        remaining = FeatureSet::IndexList();
+        for (std::size_t k = 0; k < added.size(); ++k)
+            if (!cancelled[k])
+                remaining.push_back(added[k]);
+        added = remaining;
+    }
+
     // NOTE: The parameter states_to_update is an array of position states.
     //       All states must be sequential, that is states_to_update[i] must either be reachable
     //       by repeatedly applying ->previous from states_to_update[i+1].
@@ -468,8 +511,21 @@ class FeatureTransformer {
             const StateInfo* end_state = i == 0 ? computed_st : states_to_update[i - 1];
 
             for (StateInfo* st2 = states_to_update[i]; st2 != end_state; st2 = st2->previous)
+            {
+                assert(removed[i].size() + FeatureSet::update_cost(st2)
+                         <= FeatureSet::MaxActiveDimensions
+                       && added[i].size() + FeatureSet::update_cost(st2)
+                            <= FeatureSet::MaxActiveDimensions);
+
                 FeatureSet::append_changed_indices<Perspective>(ksq, st2->dirtyPiece, removed[i],
                                                                 added[i]);
+            }
+
+            // A single move only removes and adds the same feature in a Chess960
+            // castling where the king stays on its square. The two columns then
+            // cancel out in the update, so the pass is only made over several plies.
+            if (states_to_update[i]->previous != end_state)
+                cancel_common_indices(removed[i], added[i]);
         }
 
         StateInfo* st = computed_st;
@@ -814,25 +870,33 @@ class FeatureTransformer {
     void hint_common_access_for_perspective(const Position&                           pos,
                                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
 
-        // Works like update_accumulator, but performs less work.
-        // Updates ONLY the accumulator for pos.
+        // Works like update_accumulator, but performs less work. The accumulator
+        // of pos is refreshed at once if it has to be. Otherwise it is only marked
+        // as hinted and gets updated together with the first position below pos
+        // that is evaluated, so that nothing is done if all the children are cut
+        // off by the transposition table.
+        auto& accumulator = pos.state()->*accPtr;
 
-        // Look for a usable accumulator of an earlier position. We keep track
-        // of the estimated gain in terms of features to be added/subtracted.
         // Fast early exit.
-        if ((pos.state()->*accPtr).computed[Perspective])
+        if (accumulator.computed[Perspective] || accumulator.hinted[Perspective])
             return;
 
         auto [oldest_st, _] = try_find_computed_accumulator<Perspective>(pos);
 
         if ((oldest_st->*accPtr).computed[Perspective])
         {
-            // Only update current position accumulator to minimize work.
-            StateInfo* states_to_update[1] = {pos.state()};
-            update_accumulator_incremental<Perspective, 1>(pos, oldest_st, states_to_update);
+            accumulator.hinted[Perspective] = true;
+
+            if constexpr (SearchStatsEnabled)
+                cache->deferred++;
         }
         else
+        {
             update_accumulator_refresh_cache<Perspective>(pos, cache);
+
+            if constexpr (SearchStatsEnabled)
+                cache->refreshes++;
+        }
     }
 
     template<Color Perspective>
@@ -849,8 +913,23 @@ class FeatureTransformer {
             // Now update the accumulators listed in states_to_update[], where the last element is a sentinel.
             // Currently we update 2 accumulators.
             //     1. for the current position
-            //     2. the next accumulator after the computed one
+            //     2. the nearest hinted common parent on the way, otherwise the
+            //        next accumulator after the computed one
             // The heuristic may change in the future.
+            for (StateInfo* st = pos.state()->previous; st != oldest_st; st = st->previous)
+                if ((st->*accPtr).hinted[Perspective])
+                {
+                    next = st;
+                    break;
+                }
+
+            if constexpr (SearchStatsEnabled)
+            {
+                cache->deferredComputed += (pos.state()->*accPtr).hinted[Perspective];
+                if (next != pos.state())
+                    cache->deferredComputed += (next->*accPtr).hinted[Perspective];
+            }
+
             if (next == pos.state())
             {
                 StateInfo* states_to_update[1] = {next};
@@ -863,9 +942,20 @@ class FeatureTransformer {
 
                 update_accumulator_incremental<Perspective, 2>(pos, oldest_st, states_to_update);
             }
+
+            if constexpr (SearchStatsEnabled)
+                cache->updates++;
         }
         else
+        {
             update_accumulator_refresh_cache<Perspective>(pos, cache);
+
+            if constexpr (SearchStatsEnabled)
+            {
+                cache->refreshes++;
+                cache->deferredComputed += (pos.state()->*accPtr).hinted[Perspective];
+            }
+        }
     }
 
     template<IndexType Size>
@@ -19,9 +19,12 @@
 #ifndef NUMA_H_INCLUDED
 #define NUMA_H_INCLUDED
 
+#include <algorithm>
 #include <atomic>
 #include <cstdint>
 #include <cstdlib>
+#include <fstream>
+#include <functional>
 #include <iostream>
 #include <limits>
 #include <map>
@@ -41,6 +44,8 @@
         #define _GNU_SOURCE
     #endif
     #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
 #elif defined(_WIN32)
 
 // On Windows each processor group can have up to 64 processors.
@@ -70,6 +75,61 @@ using NumaIndex = size_t;
 inline const CpuIndex SYSTEM_THREADS_NB =
   std::max<CpuIndex>(1, std::thread::hardware_concurrency());
 
+// Capacity of the fastest processors, see NumaConfig::get_cpu_capacities()
+inline constexpr size_t MAX_CPU_CAPACITY = 1024;
+
+// Returns the number of pages of the given memory range that reside on each
+// NUMA node, indexed by the kernel's node number. Only a bounded sample of pages
+// is queried, so for large ranges the counts are proportional, not exact.
+// Returns an empty vector if the placement cannot be queried on this platform.
+inline std::vector<size_t> get_page_count_by_numa_node(const void* mem, size_t size) {
+
+    std::vector<size_t> counts;
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(SYS_move_pages)
+
+    constexpr size_t PageSize   = 4096;
+    constexpr size_t MaxSamples = 4096;
+
+    const size_t totalPages = size / PageSize;
+    const size_t samples    = std::min(totalPages, MaxSamples);
+
+    if (mem == nullptr || samples == 0)
+        return counts;
+
+    std::vector<void*> pages(samples);
+    std::vector<int>   status(samples, -1);
+
+    for (size_t i = 0; i < samples; ++i)
+        pages[i] = const_cast<char*>(static_cast<const char*>(mem))
+                 + totalPages * i / samples * PageSize;
+
+    // With a null node list move_pages() only reports where each page lives
+    if (syscall(SYS_move_pages, 0, samples, pages.data(), nullptr, status.data(), 0) != 0)
+        return counts;
+
+    for (int node : status)
+    {
+        // Negative values are errors, e.g. -ENOENT for a page not yet touched
+        if (node < 0)
+            continue;
+
+        if (size_t(node) >= counts.size())
+            counts.resize(node + 1, 0);
+
+        counts[node] += 1;
+    }
+
+#else
+
+    (void) mem;
+    (void) size;
+
+#endif
+
+    return counts;
+}
+
 // We want to abstract the purpose of storing the numa node index somewhat.
 // Whoever is using this does not need to know the specifics of the replication
 // machinery to be able to access NUMA replicated memory.
@@ -175,6 +235,83 @@ class NumaConfig {
         return cpus;
     }
 
+    // Queries the relative performance of the processors on hybrid CPUs, like
+    // big.LITTLE ARM parts or Intel parts with P-cores and E-cores. The fastest
+    // processors have MAX_CPU_CAPACITY, the others a proportionally lower value.
+    // Returns an empty map when all processors are alike or when it can't be known.
+    // On Linux the scheduler exports the capacities in sysfs on most hybrid ARM
+    // systems and recent kernels. Otherwise the Intel core types are read from
+    // the PMU devices, the E-cores being rated by their maximum frequency.
+    static std::map<CpuIndex, size_t> get_cpu_capacities() {
+        std::map<CpuIndex, size_t> capacities;
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+        auto read_number = [](const std::string& path) -> size_t {
+            std::ifstream f(path);
+            size_t        value = 0;
+            return f >> value ? value : 0;
+        };
+
+        auto cpu_path = [](CpuIndex c, const std::string& file) {
+            return "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/" + file;
+        };
+
+        for (CpuIndex c = 0; c < SYSTEM_THREADS_NB; ++c)
+            if (size_t capacity = read_number(cpu_path(c, "cpu_capacity")))
+                capacities[c] = capacity;
+
+        if (capacities.empty())
+        {
+            std::ifstream coreFile("/sys/devices/cpu_core/cpus");
+            std::ifstream atomFile("/sys/devices/cpu_atom/cpus");
+            std::string   coreList, atomList;
+
+            if (coreFile >> coreList && atomFile >> atomList)
+            {
+                const std::set<CpuIndex> cores = parse_cpu_list(coreList);
+                const std::set<CpuIndex> atoms = parse_cpu_list(atomList);
+
+                auto max_freq = [&](const std::set<CpuIndex>& cpus) {
+                    size_t freq = 0;
+                    for (CpuIndex c : cpus)
+                        freq = std::max(freq, read_number(cpu_path(c, "cpufreq/cpuinfo_max_freq")));
+                    return freq;
+                };
+
+                const size_t coreFreq = max_freq(cores);
+                const size_t atomFreq = max_freq(atoms);
+
+                // Without frequencies we assume an E-core to be worth half a P-core
+                const size_t atomCapacity = coreFreq && atomFreq && atomFreq < coreFreq
+                                            ? MAX_CPU_CAPACITY * atomFreq / coreFreq
+                                            : MAX_CPU_CAPACITY / 2;
+
+                for (CpuIndex c : cores)
+                    capacities[c] = MAX_CPU_CAPACITY;
+                for (CpuIndex c : atoms)
+                    capacities[c] = atomCapacity;
+            }
+        }
+
+#endif
+
+        size_t highest = 0, lowest = std::numeric_limits<size_t>::max();
+        for (auto&& [c, capacity] : capacities)
+        {
+            highest = std::max(highest, capacity);
+            lowest  = std::min(lowest, capacity);
+        }
+
+        if (highest == lowest)
+            return {};
+
+        for (auto&& [c, capacity] : capacities)
+            capacity = std::max<size_t>(1, capacity * MAX_CPU_CAPACITY / highest);
+
+        return capacities;
+    }
+
     // This function queries the system for the mapping of processors to NUMA nodes.
     // On Linux we utilize `lscpu` to avoid libnuma.
     // On Windows we utilize GetNumaProcessorNodeEx, which has its quirks, see
@@ -330,6 +467,7 @@ class NumaConfig {
 
         // We have to ensure no empty NUMA nodes persist.
         cfg.remove_empty_numa_nodes();
+        cfg.set_cpu_capacities(get_cpu_capacities());
 
         return cfg;
     }
@@ -379,6 +517,7 @@ class NumaConfig {
         }
 
         cfg.customAffinity = true;
+        cfg.set_cpu_capacities(get_cpu_capacities());
 
         return cfg;
     }
@@ -410,34 +549,7 @@ class NumaConfig {
             if (!isFirstNode)
                 str += ":";
 
-            bool isFirstSet = true;
-            auto rangeStart = cpus.begin();
-            for (auto it = cpus.begin(); it != cpus.end(); ++it)
-            {
-                auto next = std::next(it);
-                if (next == cpus.end() || *next != *it + 1)
-                {
-                    // cpus[i] is at the end of the range (may be of size 1)
-                    if (!isFirstSet)
-                        str += ",";
-
-                    const CpuIndex last = *it;
-
-                    if (it != rangeStart)
-                    {
-                        const CpuIndex first = *rangeStart;
-
-                        str += std::to_string(first);
-                        str += "-";
-                        str += std::to_string(last);
-                    }
-                    else
-                        str += std::to_string(last);
-
-                    rangeStart = next;
-                    isFirstSet = false;
-                }
-            }
+            str += cpu_list_to_string(cpus);
 
             isFirstNode = false;
         }
@@ -454,6 +566,9 @@ class NumaConfig {
         // We also suggest binding if there's enough threads to distribute among nodes
         // with minimal disparity.
         // We try to ignore small nodes, in particular the empty ones.
+        // Hybrid processors are not a reason to bind by themselves: several
+        // engines on one host would all pin their threads onto the same fastest
+        // cores. Binding to the core classes has to be asked for with NumaPolicy.
 
         // If the affinity set by the user does not match the affinity given by the OS
         // then binding is necessary to ensure the threads are running on correct processors.
@@ -521,10 +636,98 @@ class NumaConfig {
         return ns;
     }
 
-    NumaReplicatedAccessToken bind_current_thread_to_numa_node(NumaIndex n) const {
+    bool is_hybrid() const { return !capacityByCpu.empty(); }
+
+    // Relative performance of the given processor, MAX_CPU_CAPACITY on the fastest ones
+    size_t cpu_capacity(CpuIndex c) const {
+        auto it = capacityByCpu.find(c);
+        return it != capacityByCpu.end() ? it->second : MAX_CPU_CAPACITY;
+    }
+
+    // Lists the processors by decreasing capacity, for example "1024:0-7,512:8-15".
+    // Empty if all processors are alike.
+    std::string core_classes_to_string() const {
+        std::map<size_t, std::set<CpuIndex>, std::greater<size_t>> classes;
+        for (auto&& [c, capacity] : capacityByCpu)
+            classes[capacity].insert(c);
+
+        std::string str;
+        for (auto&& [capacity, cpus] : classes)
+        {
+            if (!str.empty())
+                str += " ";
+
+            str += std::to_string(capacity) + ":" + cpu_list_to_string(cpus);
+        }
+
+        return str;
+    }
+
+    // Picks the class of processors, given by its capacity, each thread is to be
+    // bound to within the NUMA node it was given. Threads are handed out in order
+    // to the fastest processors with no thread yet, so that the main thread and
+    // the first helpers run on the fastest cores. Once all processors are taken
+    // the threads are spread in proportion to the size of each class.
+    // Returns an empty vector if all processors are alike.
+    std::vector<size_t> distribute_threads_among_core_classes(
+      const std::vector<NumaIndex>& threadNodes) const {
+        std::vector<size_t> capacities;
+
+        if (!is_hybrid())
+            return capacities;
+
+        // For each node, the number of processors and threads of each class
+        std::vector<std::map<size_t, std::pair<size_t, size_t>, std::greater<size_t>>> classes(
+          nodes.size());
+        for (NumaIndex n = 0; n < nodes.size(); ++n)
+            for (CpuIndex c : nodes[n])
+                classes[n][cpu_capacity(c)].first += 1;
+
+        for (NumaIndex n : threadNodes)
+        {
+            size_t bestCapacity = 0;
+            float  bestFill     = std::numeric_limits<float>::max();
+
+            for (auto&& [capacity, counts] : classes[n])
+            {
+                float fill =
+                  static_cast<float>(counts.second + 1) / static_cast<float>(counts.first);
+
+                if (counts.second < counts.first)
+                {
+                    bestCapacity = capacity;
+                    break;
+                }
+
+                if (fill < bestFill)
+                {
+                    bestCapacity = capacity;
+                    bestFill     = fill;
+                }
+            }
+
+            classes[n][bestCapacity].second += 1;
+            capacities.push_back(bestCapacity);
+        }
+
+        return capacities;
+    }
+
+    // Binds the current thread to the processors of the given NUMA node. With a
+    // non-zero capacity only the processors of this class are used, if any.
+    NumaReplicatedAccessToken bind_current_thread_to_numa_node(NumaIndex n,
+                                                                size_t    capacity = 0) const {
         if (n >= nodes.size() || nodes[n].size() == 0)
             std::exit(EXIT_FAILURE);
 
+        // Fall back to the whole node when it has no processor of this class
+        const bool anyOfClass =
+          capacity != 0 && std::any_of(nodes[n].begin(), nodes[n].end(), [&](CpuIndex c) {
+              return cpu_capacity(c) == capacity;
+          });
+
+        auto is_cpu_used = [&](CpuIndex c) { return !anyOfClass || cpu_capacity(c) == capacity; };
+
 #if defined(__linux__) && !defined(__ANDROID__)
 
         cpu_set_t* mask = CPU_ALLOC(highestCpuIndex + 1);
@@ -536,7 +739,8 @@ class NumaConfig {
         CPU_ZERO_S(masksize, mask);
 
         for (CpuIndex c : nodes[n])
-            CPU_SET_S(c, masksize, mask);
+            if (is_cpu_used(c))
+                CPU_SET_S(c, masksize, mask);
 
         const int status = sched_setaffinity(0, masksize, mask);
 
@@ -570,6 +774,9 @@ class NumaConfig {
 
             for (CpuIndex c : nodes[n])
             {
+                if (!is_cpu_used(c))
+                    continue;
+
                 const size_t procGroupIndex     = c / WIN_PROCESSOR_GROUP_SIZE;
                 const size_t idxWithinProcGroup = c % WIN_PROCESSOR_GROUP_SIZE;
                 groupAffinities[procGroupIndex].Mask |= KAFFINITY(1) << idxWithinProcGroup;
@@ -613,7 +820,7 @@ class NumaConfig {
                 // We skip processors that are not in the same proccessor group.
                 // If everything was set up correctly this will never be an issue,
                 // but we have to account for bad NUMA node specification.
-                if (procGroupIndex != forcedProcGroupIndex)
+                if (procGroupIndex != forcedProcGroupIndex || !is_cpu_used(c))
                     continue;
 
                 affinity.Mask |= KAFFINITY(1) << idxWithinProcGroup;
@@ -648,6 +855,7 @@ class NumaConfig {
    private:
     std::vector<std::set<CpuIndex>> nodes;
     std::map<CpuIndex, NumaIndex>   nodeByCpu;
+    std::map<CpuIndex, size_t>      capacityByCpu;  // Empty unless hybrid
     CpuIndex                        highestCpuIndex;
 
     bool customAffinity;
@@ -660,6 +868,76 @@ class NumaConfig {
         highestCpuIndex(0),
         customAffinity(false) {}
 
+    // ','-separated cpu indices with the "first-last" range syntax, as in sysfs
+    static std::string cpu_list_to_string(const std::set<CpuIndex>& cpus) {
+        std::string str;
+
+        bool isFirstSet = true;
+        auto rangeStart = cpus.begin();
+        for (auto it = cpus.begin(); it != cpus.end(); ++it)
+        {
+            auto next = std::next(it);
+            if (next == cpus.end() || *next != *it + 1)
+            {
+                // cpus[i] is at the end of the range (may be of size 1)
+                if (!isFirstSet)
+                    str += ",";
+
+                const CpuIndex last = *it;
+
+                if (it != rangeStart)
+                {
+                    const CpuIndex first = *rangeStart;
+
+                    str += std::to_string(first);
+                    str += "-";
+                    str += std::to_string(last);
+                }
+                else
+                    str += std::to_string(last);
+
+                rangeStart = next;
+                isFirstSet = false;
+            }
+        }
+
+        return str;
+    }
+
+    static std::set<CpuIndex> parse_cpu_list(const std::string& s) {
+        std::set<CpuIndex> cpus;
+
+        for (const std::string& cpuStr : split(s, ","))
+        {
+            auto parts = split(cpuStr, "-");
+            if (cpuStr.empty() || parts.size() > 2)
+                continue;
+
+            const CpuIndex cfirst = CpuIndex{str_to_size_t(parts[0])};
+            const CpuIndex clast  = CpuIndex{str_to_size_t(parts.back())};
+            for (CpuIndex c = cfirst; c <= clast; ++c)
+                cpus.insert(c);
+        }
+
+        return cpus;
+    }
+
+    // Keeps the capacities of the processors of this config, if they differ
+    void set_cpu_capacities(const std::map<CpuIndex, size_t>& capacities) {
+        std::set<size_t> distinct;
+
+        capacityByCpu.clear();
+        for (auto&& [c, n] : nodeByCpu)
+        {
+            auto it          = capacities.find(c);
+            capacityByCpu[c] = it != capacities.end() ? it->second : MAX_CPU_CAPACITY;
+            distinct.insert(capacityByCpu[c]);
+        }
+
+        if (distinct.size() < 2)
+            capacityByCpu.clear();
+    }
+
     void remove_empty_numa_nodes() {
         std::vector<std::set<CpuIndex>> newNodes;
         for (auto&& cpus : nodes)
@@ -734,9 +1012,11 @@ class NumaReplicatedBase {
     NumaReplicationContext* context;
 };
 
-// We force boxing with a unique_ptr. If this becomes an issue due to added indirection we
+// We force boxing with a shared_ptr. If this becomes an issue due to added indirection we
 // may need to add an option for a custom boxing type.
 // When the NUMA config changes the value stored at the index 0 is replicated to other nodes.
+// The replicas can be shared by objects of other contexts with the same NUMA config, see
+// share(). Shared replicas are never modified, they are copied first.
 template<typename T>
 class NumaReplicated: public NumaReplicatedBase {
    public:
@@ -784,7 +1064,7 @@ class NumaReplicated: public NumaReplicatedBase {
 
     template<typename FuncT>
     void modify_and_replicate(FuncT&& f) {
-        auto source = std::move(instances[0]);
+        auto source = take_source();
         std::forward<FuncT>(f)(*source);
         replicate_from(std::move(*source));
     }
@@ -792,12 +1072,34 @@ class NumaReplicated: public NumaReplicatedBase {
     void on_numa_config_changed() override {
         // Use the first one as the source. It doesn't matter which one we use, because they all must
         // be identical, but the first one is guaranteed to exist.
-        auto source = std::move(instances[0]);
+        auto source = take_source();
         replicate_from(std::move(*source));
     }
 
+    const std::vector<std::shared_ptr<T>>& replicas() const { return instances; }
+
+    // Uses the replicas of another object, made for the same NUMA config, instead
+    // of its own ones. Returns false if their number does not fit this config.
+    // The caller must ensure that no other thread modifies the object meanwhile.
+    bool share(const std::vector<std::shared_ptr<T>>& others) {
+        const NumaConfig& cfg = get_numa_config();
+        if (others.size() != (cfg.requires_memory_replication() ? cfg.num_numa_nodes() : 1))
+            return false;
+
+        instances = others;
+        return true;
+    }
+
    private:
-    std::vector<std::unique_ptr<T>> instances;
+    std::vector<std::shared_ptr<T>> instances;
+
+    // The first replica, to be modified or moved from, copied if it is shared
+    std::shared_ptr<T> take_source() {
+        auto source = std::move(instances[0]);
+        if (source.use_count() > 1)
+            source = std::make_shared<T>(std::as_const(*source));
+        return source;
+    }
 
     void replicate_from(T&& source) {
         instances.clear();
@@ -808,7 +1110,7 @@ class NumaReplicated: public NumaReplicatedBase {
             for (NumaIndex n = 0; n < cfg.num_numa_nodes(); ++n)
             {
                 cfg.execute_on_numa_node(
-                  n, [this, &source]() { instances.emplace_back(std::make_unique<T>(source)); });
+                  n, [this, &source]() { instances.emplace_back(std::make_shared<T>(source)); });
             }
         }
         else
@@ -816,7 +1118,7 @@ class NumaReplicated: public NumaReplicatedBase {
             assert(cfg.num_numa_nodes() == 1);
             // We take advantage of the fact that replication is not required
             // and reuse the source value, avoiding one copy operation.
-            instances.emplace_back(std::make_unique<T>(std::move(source)));
+            instances.emplace_back(std::make_shared<T>(std::move(source)));
         }
     }
 };
@@ -682,6 +682,8 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
     // Used by NNUE
     st->accumulatorBig.computed[WHITE]     = st->accumulatorBig.computed[BLACK] =
       st->accumulatorSmall.computed[WHITE] = st->accumulatorSmall.computed[BLACK] = false;
+    st->accumulatorBig.hinted[WHITE]     = st->accumulatorBig.hinted[BLACK] =
+      st->accumulatorSmall.hinted[WHITE] = st->accumulatorSmall.hinted[BLACK] = false;
 
     auto& dp     = st->dirtyPiece;
     dp.dirty_num = 1;
@@ -969,6 +971,8 @@ void Position::do_null_move(StateInfo& newSt, TranspositionTable& tt) {
     st->dirtyPiece.piece[0]                = NO_PIECE;  // Avoid checks in UpdateAccumulator()
     st->accumulatorBig.computed[WHITE]     = st->accumulatorBig.computed[BLACK] =
       st->accumulatorSmall.computed[WHITE] = st->accumulatorSmall.computed[BLACK] = false;
+    st->accumulatorBig.hinted[WHITE]     = st->accumulatorBig.hinted[BLACK] =
+      st->accumulatorSmall.hinted[WHITE] = st->accumulatorSmall.hinted[BLACK] = false;
 
     if (st->epSquare != SQ_NONE)
     {
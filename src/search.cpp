@@ -25,6 +25,7 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <initializer_list>
 #include <string>
 #include <utility>
@@ -50,7 +51,6 @@ namespace Stockfish {
 
 namespace TB = Tablebases;
 
-using Eval::evaluate;
 using namespace Search;
 
 namespace {
@@ -157,6 +157,9 @@ void Search::Worker::start_searching() {
     if (!is_mainthread())
     {
         iterative_deepening();
+
+        if (threads.deterministic.enabled())
+            threads.deterministic.finish(false);
         return;
     }
 
@@ -174,19 +177,27 @@ void Search::Worker::start_searching() {
     {
         threads.start_searching();  // start non-main threads
         iterative_deepening();      // main thread start searching
+
+        if (threads.deterministic.enabled())
+            threads.deterministic.finish(!main_manager()->ponder && !limits.infinite);
     }
 
     // When we reach the maximum depth, we can arrive here without a raise of
     // threads.stop. However, if we are pondering or in an infinite search,
     // the UCI protocol states that we shouldn't print the best move before the
-    // GUI sends a "stop" or "ponderhit" command. We therefore simply wait here
+    // GUI sends a "stop" or "ponderhit" command. We therefore wait here
     // until the GUI sends one of those commands.
-    while (!threads.stop && (main_manager()->ponder || limits.infinite))
-    {}  // Busy wait for a stop or a ponder reset
+    threads.wait_for_stop_or_ponderhit(
+      [&] { return !threads.stop && (main_manager()->ponder || limits.infinite); });
 
     // Stop the threads if not already stopped (also raise the stop if
-    // "ponderhit" just reset threads.ponder).
+    // "ponderhit" just reset threads.ponder). A deterministic search is
+    // stopped at the next synchronization point.
+    if (threads.deterministic.enabled())
+        threads.deterministic.stop();
+
     threads.stop = true;
+    threads.stopTimer.disarm();
 
     // Wait until all threads have finished
     threads.wait_for_search_finished();
@@ -250,7 +261,7 @@ void Search::Worker::iterative_deepening() {
     for (int i = 7; i > 0; --i)
     {
         (ss - i)->continuationHistory =
-          &this->continuationHistory[0][0][NO_PIECE][0];  // Use as a sentinel
+          continuation_history(false, false, NO_PIECE, SQ_A1);  // Use as a sentinel
         (ss - i)->staticEval = VALUE_NONE;
     }
 
@@ -287,6 +298,21 @@ void Search::Worker::iterative_deepening() {
         if (mainThread)
             totBestMoveChanges /= 2;
 
+        // With RootSplit the main thread hands out the root moves of the next
+        // depth, which the helpers search before their own iterations to fill
+        // the transposition table ahead of the main thread. On hybrid CPUs only
+        // the helpers on the fastest cores take these deeper searches.
+        if (threads.rootSplit.enabled())
+        {
+            RootSplitScheduler::Item item;
+
+            if (mainThread)
+                threads.rootSplit.publish(rootDepth + 1, rootMoves);
+            else if (threads.core_capacity(thread_idx) == MAX_CPU_CAPACITY)
+                while (!threads.stop && threads.rootSplit.take(thread_idx, item))
+                    search_root_move(ss, item.depth, item.move);
+        }
+
         // Save the last iteration's scores before the first PV line is searched and
         // all the move scores except the (new) PV are set to -VALUE_INFINITE.
         for (RootMove& rm : rootMoves)
@@ -395,6 +421,20 @@ void Search::Worker::iterative_deepening() {
         if (!threads.stop)
             completedDepth = rootDepth;
 
+        // Now that there is a move to play, let the stop timer end the search
+        // at its hard deadline
+        if (mainThread && completedDepth == 1 && !limits.npmsec
+            && (limits.use_time_management() || limits.movetime))
+        {
+            TimePoint deadline = limits.use_time_management()
+                                 ? limits.startTime + mainThread->tm.maximum() + 1
+                                 : limits.startTime + limits.movetime;
+            if (limits.use_time_management() && limits.movetime)
+                deadline = std::min(deadline, limits.startTime + limits.movetime);
+
+            threads.stopTimer.arm(deadline);
+        }
+
         // We make sure not to pick an unproven mated-in score,
         // in case this thread prematurely stopped search (aborted-search).
         if (threads.abortedSearch && rootMoves[0].score != -VALUE_INFINITE
@@ -423,7 +463,13 @@ void Search::Worker::iterative_deepening() {
                 || (rootMoves[0].score != -VALUE_INFINITE
                     && rootMoves[0].score <= VALUE_MATED_IN_MAX_PLY
                     && VALUE_MATE + rootMoves[0].score <= 2 * limits.mate)))
+        {
+            // A deterministic search is stopped at the next synchronization point
+            if (threads.deterministic.enabled())
+                break;
+
             threads.stop = true;
+        }
 
         // If the skill level is enabled and time is up, pick a sub-optimal best move
         if (skill.enabled() && skill.time_to_pick(rootDepth))
@@ -496,6 +542,62 @@ void Search::Worker::iterative_deepening() {
                              skill.best ? skill.best : skill.pick_best(rootMoves, multiPV)));
 }
 
+// Searches the given root move alone, with an aspiration window around its
+// average score. The result is only shared through the transposition table:
+// the move keeps its place in rootMoves and the completed depth of the thread,
+// which is used for best thread selection, is left untouched.
+void Search::Worker::search_root_move(Stack* ss, Depth depth, Move move) {
+
+    auto rm = std::find(rootMoves.begin(), rootMoves.end(), move);
+    if (rm == rootMoves.end())
+        return;
+
+    // The result only reaches the other threads through the transposition
+    // table. The root moves of the thread are restored afterwards, so that
+    // their scores and PVs stay those of its own completed depth, on which
+    // the best thread is voted.
+    const RootMoves iterationRootMoves = rootMoves;
+    const Depth     iterationDepth     = rootDepth;
+
+    pvIdx     = size_t(rm - rootMoves.begin());
+    pvLast    = pvIdx + 1;
+    rootDepth = depth;
+    selDepth  = 0;
+
+    Value avg   = rm->averageScore;
+    int   delta = 9 + avg * avg / 10502;
+    Value alpha = std::max(avg - delta, -VALUE_INFINITE);
+    Value beta  = std::min(avg + delta, VALUE_INFINITE);
+
+    while (!threads.stop)
+    {
+        rootDelta   = beta - alpha;
+        Value value = search<Root>(rootPos, ss, alpha, beta, depth, false);
+
+        if (value <= alpha)
+        {
+            beta  = (alpha + beta) / 2;
+            alpha = std::max(value - delta, -VALUE_INFINITE);
+        }
+        else if (value >= beta)
+            beta = std::min(value + delta, VALUE_INFINITE);
+        else
+            break;
+
+        delta += delta / 3;
+    }
+
+    rootMoves = iterationRootMoves;
+    rootDepth = iterationDepth;
+}
+
+void Search::Worker::init_reductions() {
+    const size_t threadCount = std::max(threads.size(), size_t(1));
+
+    for (size_t i = 1; i < reductions.size(); ++i)
+        reductions[i] = int((19.90 + std::log(threadCount) / 2) * std::log(i));
+}
+
 void Search::Worker::clear() {
     counterMoves.fill(Move::none());
     mainHistory.fill(0);
@@ -503,16 +605,88 @@ void Search::Worker::clear() {
     pawnHistory.fill(-1300);
     correctionHistory.fill(0);
 
-    for (bool inCheck : {false, true})
-        for (StatsType c : {NoCaptures, Captures})
-            for (auto& to : continuationHistory[inCheck][c])
-                for (auto& h : to)
-                    h->fill(-60);
+    // Continuation histories are refilled on first use, see continuation_history().
+    // If the epoch wraps around all the tables are marked as stale again.
+    if (++historyEpoch == 0)
+    {
+        std::memset(continuationEpoch, 0, sizeof(continuationEpoch));
+        historyEpoch = 1;
+    }
 
-    for (size_t i = 1; i < reductions.size(); ++i)
-        reductions[i] = int((19.90 + std::log(size_t(options["Threads"])) / 2) * std::log(i));
+    init_reductions();
 
     refreshTable.clear(networks[numaAccessToken]);
+
+    hotTT.resize(size_t(options["HotHash"]));
+    ttStats = {};
+    stats   = {};
+}
+
+
+// Evaluates the position with the networks and accumulator caches of the thread
+Value Search::Worker::evaluate(const Position& pos) {
+    return Eval::evaluate(networks[numaAccessToken], pos, refreshTable,
+                          optimism[pos.side_to_move()]);
+}
+
+
+// At shallow depth the hot table is probed first. Entries found only in the
+// shared table are promoted to the hot one, where later visits by this thread
+// find them. Saves into the hot table are written through, see save_tt().
+TTEntry* Search::Worker::probe_tt(Key key, Depth depth, bool& found) {
+
+    TTEntry* hte = nullptr;
+
+    if (hotTT.enabled() && depth <= HotTranspositionTable::MaxDepth)
+    {
+        hte = hotTT.probe(key, found);
+
+        if constexpr (SearchStatsEnabled)
+        {
+            ttStats.hotProbes++;
+            ttStats.hotHits += found;
+        }
+
+        if (found)
+            return hte;
+    }
+
+    TTEntry* tte = ttLog.enabled() ? ttLog.probe(tt, key, found) : tt.probe(key, found);
+
+    if constexpr (SearchStatsEnabled)
+    {
+        ttStats.probes++;
+        ttStats.hits += found;
+    }
+
+    if (found && hte)
+    {
+        *hte = *tte;
+        return hte;
+    }
+
+    return tte;
+}
+
+
+// Allocates the transposition table log of the thread for a deterministic
+// search, or frees it, and sets the node count of its first synchronization.
+void Search::Worker::start_deterministic(bool on) {
+
+    if (on != ttLog.enabled())
+        ttLog = TTCommitLog();
+
+    if (on && !ttLog.enabled())
+        ttLog.resize(DeterministicSync::Quantum);
+
+    ttLog.start();
+    nextSyncNodes = on ? DeterministicSync::Quantum : UINT64_MAX;
+}
+
+void Search::Worker::sync_threads() {
+
+    nextSyncNodes += DeterministicSync::Quantum;
+    threads.deterministic.sync();
 }
 
 
@@ -528,6 +702,9 @@ Value Search::Worker::search(
     if (depth <= 0)
         return qsearch < PvNode ? PV : NonPV > (pos, ss, alpha, beta);
 
+    if constexpr (SearchStatsEnabled)
+        stats.nodes++;
+
     // Check if we have an upcoming move that draws by repetition, or
     // if the opponent had an alternative move earlier to this position.
     if (!rootNode && alpha < VALUE_DRAW && pos.has_game_cycle(ss->ply))
@@ -578,8 +755,7 @@ Value Search::Worker::search(
         // Step 2. Check for aborted search and immediate draw
         if (threads.stop.load(std::memory_order_relaxed) || pos.is_draw(ss->ply)
             || ss->ply >= MAX_PLY)
-            return (ss->ply >= MAX_PLY && !ss->inCheck) ? evaluate(
-                     networks[numaAccessToken], pos, refreshTable, thisThread->optimism[us])
+            return (ss->ply >= MAX_PLY && !ss->inCheck) ? evaluate(pos)
                                                         : value_draw(thisThread->nodes);
 
         // Step 3. Mate distance pruning. Even if we mate at the next move our score
@@ -605,7 +781,7 @@ Value Search::Worker::search(
     // Step 4. Transposition table lookup.
     excludedMove = ss->excludedMove;
     posKey       = pos.key();
-    tte          = tt.probe(posKey, ss->ttHit);
+    tte          = probe_tt(posKey, depth, ss->ttHit);
     ttValue   = ss->ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttMove    = rootNode  ? thisThread->rootMoves[thisThread->pvIdx].pv[0]
               : ss->ttHit ? tte->move()
@@ -658,10 +834,16 @@ Value Search::Worker::search(
             if (is_mainthread())
                 main_manager()->callsCnt = 0;
 
+            if constexpr (SearchStatsEnabled)
+                stats.tbProbes++;
+
             if (err != TB::ProbeState::FAIL)
             {
                 thisThread->tbHits.fetch_add(1, std::memory_order_relaxed);
 
+                if constexpr (SearchStatsEnabled)
+                    stats.tbHits++;
+
                 int drawScore = tbConfig.useRule50 ? 1 : 0;
 
                 Value tbValue = VALUE_TB - ss->ply;
@@ -677,9 +859,8 @@ Value Search::Worker::search(
 
                 if (b == BOUND_EXACT || (b == BOUND_LOWER ? value >= beta : value <= alpha))
                 {
-                    tte->save(posKey, value_to_tt(value, ss->ply), ss->ttPv, b,
-                              std::min(MAX_PLY - 1, depth + 6), Move::none(), VALUE_NONE,
-                              tt.generation());
+                    save_tt(tte, posKey, value_to_tt(value, ss->ply), ss->ttPv, b,
+                            std::min(MAX_PLY - 1, depth + 6), Move::none(), VALUE_NONE);
 
                     return value;
                 }
@@ -716,8 +897,7 @@ Value Search::Worker::search(
         // Never assume anything about values stored in TT
         unadjustedStaticEval = tte->eval();
         if (unadjustedStaticEval == VALUE_NONE)
-            unadjustedStaticEval =
-              evaluate(networks[numaAccessToken], pos, refreshTable, thisThread->optimism[us]);
+            unadjustedStaticEval = evaluate(pos);
         else if (PvNode)
             Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], refreshTable);
 
@@ -729,13 +909,12 @@ Value Search::Worker::search(
     }
     else
     {
-        unadjustedStaticEval =
-          evaluate(networks[numaAccessToken], pos, refreshTable, thisThread->optimism[us]);
+        unadjustedStaticEval = evaluate(pos);
         ss->staticEval = eval = to_corrected_static_eval(unadjustedStaticEval, *thisThread, pos);
 
         // Static evaluation is saved as it was before adjustment by correction history
-        tte->save(posKey, VALUE_NONE, ss->ttPv, BOUND_NONE, DEPTH_UNSEARCHED, Move::none(),
-                  unadjustedStaticEval, tt.generation());
+        save_tt(tte, posKey, VALUE_NONE, ss->ttPv, BOUND_NONE, DEPTH_UNSEARCHED, Move::none(),
+                unadjustedStaticEval);
     }
 
     // Use static evaluation difference to improve quiet move ordering (~9 Elo)
@@ -791,7 +970,7 @@ Value Search::Worker::search(
         Depth R = std::min(int(eval - beta) / 177, 6) + depth / 3 + 5;
 
         ss->currentMove         = Move::null();
-        ss->continuationHistory = &thisThread->continuationHistory[0][0][NO_PIECE][0];
+        ss->continuationHistory = thisThread->continuation_history(false, false, NO_PIECE, SQ_A1);
 
         pos.do_null_move(st, tt);
 
@@ -870,10 +1049,9 @@ Value Search::Worker::search(
 
                 ss->currentMove = move;
                 ss->continuationHistory =
-                  &this
-                     ->continuationHistory[ss->inCheck][true][pos.moved_piece(move)][move.to_sq()];
+                  continuation_history(ss->inCheck, true, pos.moved_piece(move), move.to_sq());
 
-                thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+                thisThread->count_node();
                 pos.do_move(move, st);
 
                 // Perform a preliminary qsearch to verify that the move holds
@@ -889,8 +1067,8 @@ Value Search::Worker::search(
                 if (value >= probCutBeta)
                 {
                     // Save ProbCut data into transposition table
-                    tte->save(posKey, value_to_tt(value, ss->ply), ss->ttPv, BOUND_LOWER, depth - 3,
-                              move, unadjustedStaticEval, tt.generation());
+                    save_tt(tt_entry_to_save(tte, posKey), posKey, value_to_tt(value, ss->ply),
+                            ss->ttPv, BOUND_LOWER, depth - 3, move, unadjustedStaticEval);
                     return std::abs(value) < VALUE_TB_WIN_IN_MAX_PLY ? value - (probCutBeta - beta)
                                                                      : value;
                 }
@@ -1115,12 +1293,12 @@ moves_loop:  // When in check, search starts here
         // Update the current move (this must be done after singular extension search)
         ss->currentMove = move;
         ss->continuationHistory =
-          &thisThread->continuationHistory[ss->inCheck][capture][movedPiece][move.to_sq()];
+          thisThread->continuation_history(ss->inCheck, capture, movedPiece, move.to_sq());
 
         uint64_t nodeCount = rootNode ? uint64_t(nodes) : 0;
 
         // Step 16. Make the move
-        thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+        thisThread->count_node();
         pos.do_move(move, st, givesCheck);
 
         // These reduction adjustments have proven non-linear scaling.
@@ -1366,11 +1544,11 @@ moves_loop:  // When in check, search starts here
     // Write gathered information in transposition table
     // Static evaluation is saved as it was before correction history
     if (!excludedMove && !(rootNode && thisThread->pvIdx))
-        tte->save(posKey, value_to_tt(bestValue, ss->ply), ss->ttPv,
-                  bestValue >= beta    ? BOUND_LOWER
-                  : PvNode && bestMove ? BOUND_EXACT
-                                       : BOUND_UPPER,
-                  depth, bestMove, unadjustedStaticEval, tt.generation());
+        save_tt(tt_entry_to_save(tte, posKey), posKey, value_to_tt(bestValue, ss->ply), ss->ttPv,
+                bestValue >= beta    ? BOUND_LOWER
+                : PvNode && bestMove ? BOUND_EXACT
+                                     : BOUND_UPPER,
+                depth, bestMove, unadjustedStaticEval);
 
     // Adjust correction history
     if (!ss->inCheck && (!bestMove || !pos.capture(bestMove))
@@ -1404,6 +1582,9 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta,
     assert(PvNode || (alpha == beta - 1));
     assert(depth <= 0);
 
+    if constexpr (SearchStatsEnabled)
+        stats.qsearchNodes++;
+
     // Check if we have an upcoming move that draws by repetition, or if
     // the opponent had an alternative move earlier to this position. (~1 Elo)
     if (alpha < VALUE_DRAW && pos.has_game_cycle(ss->ply))
@@ -1444,9 +1625,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta,
 
     // Step 2. Check for an immediate draw or maximum ply reached
     if (pos.is_draw(ss->ply) || ss->ply >= MAX_PLY)
-        return (ss->ply >= MAX_PLY && !ss->inCheck)
-               ? evaluate(networks[numaAccessToken], pos, refreshTable, thisThread->optimism[us])
-               : VALUE_DRAW;
+        return (ss->ply >= MAX_PLY && !ss->inCheck) ? evaluate(pos) : VALUE_DRAW;
 
     assert(0 <= ss->ply && ss->ply < MAX_PLY);
 
@@ -1457,7 +1636,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta,
 
     // Step 3. Transposition table lookup
     posKey  = pos.key();
-    tte     = tt.probe(posKey, ss->ttHit);
+    tte     = probe_tt(posKey, depth, ss->ttHit);
     ttValue = ss->ttHit ? value_from_tt(tte->value(), ss->ply, pos.rule50_count()) : VALUE_NONE;
     ttMove  = ss->ttHit ? tte->move() : Move::none();
     pvHit   = ss->ttHit && tte->is_pv();
@@ -1479,8 +1658,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta,
             // Never assume anything about values stored in TT
             unadjustedStaticEval = tte->eval();
             if (unadjustedStaticEval == VALUE_NONE)
-                unadjustedStaticEval =
-                  evaluate(networks[numaAccessToken], pos, refreshTable, thisThread->optimism[us]);
+                unadjustedStaticEval = evaluate(pos);
             ss->staticEval = bestValue =
               to_corrected_static_eval(unadjustedStaticEval, *thisThread, pos);
 
@@ -1493,9 +1671,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta,
         {
             // In case of null move search, use previous static eval with a different sign
             unadjustedStaticEval =
-              (ss - 1)->currentMove != Move::null()
-                ? evaluate(networks[numaAccessToken], pos, refreshTable, thisThread->optimism[us])
-                : -(ss - 1)->staticEval;
+              (ss - 1)->currentMove != Move::null() ? evaluate(pos) : -(ss - 1)->staticEval;
             ss->staticEval = bestValue =
               to_corrected_static_eval(unadjustedStaticEval, *thisThread, pos);
         }
@@ -1506,8 +1682,8 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta,
             if (std::abs(bestValue) < VALUE_TB_WIN_IN_MAX_PLY && !PvNode)
                 bestValue = (3 * bestValue + beta) / 4;
             if (!ss->ttHit)
-                tte->save(posKey, value_to_tt(bestValue, ss->ply), false, BOUND_LOWER,
-                          DEPTH_UNSEARCHED, Move::none(), unadjustedStaticEval, tt.generation());
+                save_tt(tte, posKey, value_to_tt(bestValue, ss->ply), false, BOUND_LOWER,
+                        DEPTH_UNSEARCHED, Move::none(), unadjustedStaticEval);
 
             return bestValue;
         }
@@ -1600,12 +1776,11 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta,
 
         // Update the current move
         ss->currentMove = move;
-        ss->continuationHistory =
-          &thisThread
-             ->continuationHistory[ss->inCheck][capture][pos.moved_piece(move)][move.to_sq()];
+        ss->continuationHistory = thisThread->continuation_history(
+          ss->inCheck, capture, pos.moved_piece(move), move.to_sq());
 
         // Step 7. Make and search the move
-        thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+        thisThread->count_node();
         pos.do_move(move, st, givesCheck);
         value = -qsearch<nodeType>(pos, ss + 1, -beta, -alpha, depth - 1);
         pos.undo_move(move);
@@ -1646,9 +1821,8 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta,
 
     // Save gathered info in transposition table
     // Static evaluation is saved as it was before adjustment by correction history
-    tte->save(posKey, value_to_tt(bestValue, ss->ply), pvHit,
-              bestValue >= beta ? BOUND_LOWER : BOUND_UPPER, ttDepth, bestMove,
-              unadjustedStaticEval, tt.generation());
+    save_tt(tt_entry_to_save(tte, posKey), posKey, value_to_tt(bestValue, ss->ply), pvHit,
+            bestValue >= beta ? BOUND_LOWER : BOUND_UPPER, ttDepth, bestMove, unadjustedStaticEval);
 
     assert(bestValue > -VALUE_INFINITE && bestValue < VALUE_INFINITE);
 
@@ -1912,7 +2086,8 @@ void SearchManager::check_time(Search::Worker& worker) {
       worker.completedDepth >= 1
       && ((worker.limits.use_time_management() && (elapsed > tm.maximum() || stopOnPonderhit))
           || (worker.limits.movetime && elapsed >= worker.limits.movetime)
-          || (worker.limits.nodes && worker.threads.nodes_searched() >= worker.limits.nodes)))
+          || (worker.limits.nodes && worker.threads.nodes_searched() >= worker.limits.nodes
+              && !worker.threads.deterministic.enabled())))  // Checked when synchronizing
         worker.threads.stop = worker.threads.abortedSearch = true;
 }
 
@@ -1928,6 +2103,17 @@ void SearchManager::pv(const Search::Worker&     worker,
     TimePoint   time      = tm.elapsed_time() + 1;
     size_t      multiPV   = std::min(size_t(worker.options["MultiPV"]), rootMoves.size());
     uint64_t    tbHits    = threads.tb_hits() + (worker.tbConfig.rootInTB ? rootMoves.size() : 0);
+    bool        showByAge = worker.options["HashfullByAge"];
+    auto        byAge     = tt.hashfull_by_age(showByAge ? 8 : 1);
+
+    // Occupancy of the table by entries of the current and the previous searches
+    std::string hashfullByAge;
+    if (showByAge)
+    {
+        for (int permill : byAge)
+            hashfullByAge += std::to_string(permill) + " ";
+        hashfullByAge.pop_back();
+    }
 
     for (size_t i = 0; i < multiPV; ++i)
     {
@@ -1974,7 +2160,10 @@ void SearchManager::pv(const Search::Worker&     worker,
         info.nps      = nodes * 1000 / time;
         info.tbHits   = tbHits;
         info.pv       = pv;
-        info.hashfull = tt.hashfull();
+        info.hashfull = byAge[0];
+
+        if (i == 0)
+            info.hashfullByAge = hashfullByAge;
 
         updates.onUpdateFull(info);
     }
@@ -39,6 +39,7 @@
 #include "score.h"
 #include "syzygy/tbprobe.h"
 #include "timeman.h"
+#include "tt.h"
 #include "types.h"
 
 namespace Stockfish {
@@ -50,8 +51,8 @@ enum NodeType {
     Root
 };
 
-class TranspositionTable;
 class ThreadPool;
+class DeterministicSync;
 class OptionsMap;
 
 namespace Search {
@@ -156,6 +157,41 @@ class ISearchManager {
     virtual void check_time(Search::Worker&) = 0;
 };
 
+// Per-thread search statistics, see SearchStatsEnabled. The worker updates the
+// node and tablebase counters, the others are gathered by ThreadPool::search_stats().
+struct SearchStats {
+    uint64_t nodes         = 0;  // Calls to search()
+    uint64_t qsearchNodes  = 0;  // Calls to qsearch()
+    uint64_t ttProbes      = 0;
+    uint64_t ttHits        = 0;
+    uint64_t hotTTProbes   = 0;
+    uint64_t hotTTHits     = 0;
+    uint64_t nnueRefreshes = 0;  // Accumulators refreshed from the cache
+    uint64_t nnueUpdates   = 0;  // Accumulators updated incrementally
+    uint64_t nnueDeferred  = 0;  // Accumulators of common parents, computed lazily
+    uint64_t nnueSaved     = 0;  // Deferred accumulators that were never computed
+    uint64_t tbProbes      = 0;
+    uint64_t tbHits        = 0;
+    uint64_t waitTimeUs    = 0;  // Time spent waiting for the thread to finish its job
+
+    SearchStats& operator+=(const SearchStats& s) {
+        nodes += s.nodes;
+        qsearchNodes += s.qsearchNodes;
+        ttProbes += s.ttProbes;
+        ttHits += s.ttHits;
+        hotTTProbes += s.hotTTProbes;
+        hotTTHits += s.hotTTHits;
+        nnueRefreshes += s.nnueRefreshes;
+        nnueUpdates += s.nnueUpdates;
+        nnueDeferred += s.nnueDeferred;
+        nnueSaved += s.nnueSaved;
+        tbProbes += s.tbProbes;
+        tbHits += s.tbHits;
+        waitTimeUs += s.waitTimeUs;
+        return *this;
+    }
+};
+
 struct InfoShort {
     int   depth;
     Score score;
@@ -172,6 +208,7 @@ struct InfoFull: InfoShort {
     size_t           tbHits;
     std::string_view pv;
     int              hashfull;
+    std::string_view hashfullByAge;  // Permill per age, set for the first PV line if HashfullByAge
 };
 
 struct InfoIteration {
@@ -216,7 +253,7 @@ class SearchManager: public ISearchManager {
     double               previousTimeReduction;
     Value                bestPreviousScore;
     Value                bestPreviousAverageScore;
-    bool                 stopOnPonderhit;
+    std::atomic_bool     stopOnPonderhit;
 
     size_t id;
 
@@ -240,6 +277,10 @@ class Worker {
     // Reset histories, usually before a new game
     void clear();
 
+    // Reductions depend on the size of the thread pool, so they are also
+    // recomputed by workers kept across a thread pool resize.
+    void init_reductions();
+
     // Called when the program receives the UCI 'go' command.
     // It searches from the root position and outputs the "bestmove".
     void start_searching();
@@ -257,6 +298,9 @@ class Worker {
    private:
     void iterative_deepening();
 
+    // Searches a single root move, used for the work items of RootSplit
+    void search_root_move(Stack* ss, Depth depth, Move move);
+
     // Main search function for both PV and non-PV nodes
     template<NodeType nodeType>
     Value search(Position& pos, Stack* ss, Value alpha, Value beta, Depth depth, bool cutNode);
@@ -267,6 +311,66 @@ class Worker {
 
     Depth reduction(bool i, Depth d, int mn, int delta);
 
+    Value evaluate(const Position& pos);
+
+    // Probes the hot table of the thread and then the shared one
+    TTEntry* probe_tt(Key key, Depth depth, bool& found);
+
+    // In the deterministic mode the cluster of an entry probed before a subtree
+    // was searched may have been committed since, so the key is probed again.
+    TTEntry* tt_entry_to_save(TTEntry* tte, Key key) {
+        bool found;
+        return ttLog.contains(tte) ? ttLog.probe(tt, key, found) : tte;
+    }
+
+    // Saves into an entry of probe_tt(). Saves into the hot table are written
+    // through to the shared one, so that the other threads see them as well.
+    void save_tt(TTEntry* tte, Key key, Value v, bool pv, Bound b, Depth d, Move m, Value ev) {
+        tte->save(key, v, pv, b, d, m, ev, tt.generation(), tt_slot(tte), tt_occupancy(tte));
+
+        if (hotTT.contains(tte))
+        {
+            bool found;
+            tte = ttLog.enabled() ? ttLog.probe(tt, key, found) : tt.probe(key, found);
+            tte->save(key, v, pv, b, d, m, ev, tt.generation(), tt_slot(tte), tt_occupancy(tte));
+        }
+    }
+
+    // Counts a searched node. In the deterministic mode the thread waits for
+    // the others each time it has searched another DeterministicSync::Quantum nodes.
+    void count_node() {
+        if (nodes.fetch_add(1, std::memory_order_relaxed) + 1 >= nextSyncNodes)
+            sync_threads();
+    }
+
+    void start_deterministic(bool on);
+    void sync_threads();
+    void commit_tt() { ttLog.commit(tt, tt.occupancy(thread_idx)); }
+
+    // Continuation histories are cleared lazily: clear() only advances the
+    // history epoch and each table is refilled the first time it is used.
+    PieceToHistory* continuation_history(bool inCheck, bool capture, Piece pc, Square to) {
+        if (continuationEpoch[inCheck][capture][pc][to] != historyEpoch)
+        {
+            continuationHistory[inCheck][capture][pc][to]->fill(-60);
+            continuationEpoch[inCheck][capture][pc][to] = historyEpoch;
+        }
+        return &continuationHistory[inCheck][capture][pc][to];
+    }
+
+    // The slot of the given entry within its cluster. The hot table is
+    // direct-mapped, its entries are alone in their cluster.
+    int tt_slot(const TTEntry* tte) const {
+        return hotTT.contains(tte) ? 0 : ttLog.contains(tte) ? ttLog.slot(tte) : tt.slot(tte);
+    }
+
+    // The occupancy to update when saving into the given entry
+    TTOccupancy& tt_occupancy(const TTEntry* tte) {
+        return hotTT.contains(tte) ? hotTT.occupancy
+             : ttLog.contains(tte) ? ttLog.occupancy
+                                   : tt.occupancy(thread_idx);
+    }
+
     // Get a pointer to the search manager, only allowed to be called by the
     // main thread.
     SearchManager* main_manager() const {
@@ -310,7 +414,18 @@ class Worker {
     // Used by NNUE
     Eval::NNUE::AccumulatorCaches refreshTable;
 
+    HotTranspositionTable hotTT;
+    TTCommitLog           ttLog;  // Only allocated in the deterministic mode
+    TTProbeStats          ttStats;
+    SearchStats           stats;
+    uint64_t              nextSyncNodes = UINT64_MAX;
+
+    // See continuation_history()
+    uint32_t historyEpoch = 0;
+    uint32_t continuationEpoch[2][2][PIECE_NB][SQUARE_NB] = {};
+
     friend class Stockfish::ThreadPool;
+    friend class Stockfish::DeterministicSync;
     friend class SearchManager;
 };
 
@@ -20,7 +20,10 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <deque>
+#include <functional>
+#include <map>
 #include <memory>
 #include <string>
 #include <unordered_map>
@@ -43,18 +46,19 @@ Thread::Thread(Search::SharedState&                    sharedState,
                size_t                                  n,
                OptionalThreadToNumaNodeBinder          binder) :
     idx(n),
-    nthreads(sharedState.options["Threads"]),
     stdThread(&Thread::idle_loop, this) {
 
     wait_for_search_finished();
 
     run_custom_job([this, &binder, &sharedState, &sm, n]() {
         // Use the binder to [maybe] bind the threads to a NUMA node before doing
-        // the Worker allocation.
+        // the Worker allocation. The Worker, histories and accumulator caches
+        // included, takes megabytes, so it is put on large pages to save TLB
+        // misses; being first touched here it lands on the thread's NUMA node.
         // Ideally we would also allocate the SearchManager here, but that's minor.
         this->numaAccessToken = binder();
-        this->worker =
-          std::make_unique<Search::Worker>(sharedState, std::move(sm), n, this->numaAccessToken);
+        this->worker          = make_unique_large_page<Search::Worker>(
+          sharedState, std::move(sm), n, this->numaAccessToken);
     });
 
     wait_for_search_finished();
@@ -89,8 +93,17 @@ void Thread::clear_worker() {
 // until the thread has finished searching.
 void Thread::wait_for_search_finished() {
 
+    using Clock = std::chrono::steady_clock;
+
+    [[maybe_unused]] const auto start = SearchStatsEnabled ? Clock::now() : Clock::time_point();
+
     std::unique_lock<std::mutex> lk(mutex);
     cv.wait(lk, [&] { return !searching; });
+
+    if constexpr (SearchStatsEnabled)
+        waitTimeUs.fetch_add(
+          std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count(),
+          std::memory_order_relaxed);
 }
 
 void Thread::run_custom_job(std::function<void()> f) {
@@ -127,6 +140,222 @@ void Thread::idle_loop() {
     }
 }
 
+StopTimer::~StopTimer() {
+
+    if (!timerThread)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        exit = true;
+    }
+    cv.notify_one();
+    timerThread->join();
+}
+
+// Sets the time, as given by now(), at which the search is to be stopped
+void StopTimer::arm(TimePoint at) {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        deadline = at;
+        armed    = true;
+
+        if (!timerThread)
+            timerThread = std::make_unique<NativeThread>(&StopTimer::idle_loop, this);
+    }
+    cv.notify_one();
+}
+
+void StopTimer::disarm() {
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+        armed = false;
+    }
+    cv.notify_one();
+}
+
+void StopTimer::wake() {
+    { std::lock_guard<std::mutex> lk(mutex); }
+    cv.notify_one();
+}
+
+// The timer thread sleeps until the deadline, or for as long as the search
+// is pondering, and then stops the search like check_time() would do.
+void StopTimer::idle_loop() {
+
+    std::unique_lock<std::mutex> lk(mutex);
+
+    while (!exit)
+    {
+        if (!armed)
+        {
+            cv.wait(lk);
+            continue;
+        }
+
+        Search::SearchManager* mainManager = threads.main_manager();
+
+        if (mainManager->ponder)
+            cv.wait(lk);
+
+        else if (now() >= deadline || mainManager->stopOnPonderhit)
+        {
+            threads.stop = threads.abortedSearch = true;
+            armed                                 = false;
+        }
+        else
+            cv.wait_until(lk, std::chrono::steady_clock::time_point(
+                                std::chrono::milliseconds(deadline)));
+    }
+}
+
+// Called before the threads start searching, with the node limit of the search
+void DeterministicSync::start(bool on, uint64_t nodes) {
+
+    active        = on;
+    stopRequested = false;
+    nodeLimit     = nodes;
+    arrived       = 0;
+    participants  = threads.size();
+}
+
+// Waits for the other threads at the synchronization point. A stop raised
+// elsewhere, e.g. by 'stop' or a time limit, releases the waiting threads when
+// one of the threads still searching leaves.
+void DeterministicSync::sync() {
+
+    std::unique_lock<std::mutex> lk(mutex);
+
+    if (threads.stop)
+        return;
+
+    if (++arrived < participants)
+    {
+        const uint64_t current = phase;
+        cv.wait(lk, [&] { return phase != current || threads.stop; });
+        return;
+    }
+
+    complete_phase();
+    lk.unlock();
+    cv.notify_all();
+}
+
+// Called by a thread whose iterative deepening has ended. When the main thread
+// is done the search stops at the next synchronization point, unless it has to
+// wait for 'stop' or 'ponderhit'.
+void DeterministicSync::finish(bool endSearch) {
+
+    {
+        std::lock_guard<std::mutex> lk(mutex);
+
+        stopRequested |= endSearch;
+        --participants;
+
+        // Once stopped the logs are not committed, the threads may still write them
+        if (!threads.stop && arrived == participants)
+            complete_phase();
+    }
+    cv.notify_all();
+}
+
+// Called by the main thread after finish(), to stop the search at the next
+// synchronization point of the threads still searching. Returns once stopped.
+void DeterministicSync::stop() {
+
+    std::unique_lock<std::mutex> lk(mutex);
+
+    stopRequested = true;
+
+    if (!participants)
+        threads.stop = true;
+
+    cv.wait(lk, [&] { return bool(threads.stop); });
+}
+
+// Commits the logs of all the threads and raises the pending stops, called with
+// the mutex held once all the threads still searching have arrived.
+void DeterministicSync::complete_phase() {
+
+    for (auto&& th : threads)
+        th->worker->commit_tt();
+
+    // As in check_time(), the first iteration of the main thread is completed
+    if (nodeLimit && threads.nodes_searched() >= nodeLimit
+        && threads.main_thread()->worker->completedDepth >= 1)
+        threads.stop = threads.abortedSearch = true;
+    else if (stopRequested)
+        threads.stop = true;
+
+    arrived = 0;
+    ++phase;
+}
+
+// Allocates one work queue per helper thread, the main thread has none
+void RootSplitScheduler::resize(size_t threadCount) {
+
+    queues.clear();
+    while (queues.size() + 1 < threadCount)
+        queues.push_back(std::make_unique<WorkQueue>());
+
+    active = false;
+}
+
+// Drops the items of any previous search, called before the threads start
+void RootSplitScheduler::enable(bool on) {
+
+    for (auto&& q : queues)
+        q->items.clear();
+
+    active = on && !queues.empty();
+}
+
+// Replaces the pending items by one item per root move at the given depth. The
+// moves are dealt round-robin in the order of the main thread, and pushed so
+// that each helper pops the most promising of its moves first.
+void RootSplitScheduler::publish(Depth depth, const Search::RootMoves& rootMoves) {
+
+    for (size_t i = 0; i < queues.size(); ++i)
+    {
+        std::lock_guard<std::mutex> lk(queues[i]->mutex);
+
+        queues[i]->items.clear();
+        for (size_t j = i; j < rootMoves.size(); j += queues.size())
+            queues[i]->items.push_front({depth, rootMoves[j].pv[0]});
+    }
+}
+
+// Gets the next item for the given helper thread, stealing from the other
+// queues when its own one is empty. Returns false when there is no work left.
+bool RootSplitScheduler::take(size_t threadIdx, Item& item) {
+
+    assert(threadIdx > 0 && threadIdx <= queues.size());
+
+    for (size_t i = 0; i < queues.size(); ++i)
+    {
+        WorkQueue& q = *queues[(threadIdx - 1 + i) % queues.size()];
+
+        std::lock_guard<std::mutex> lk(q.mutex);
+
+        if (q.items.empty())
+            continue;
+
+        if (i == 0)  // Own queue, most promising move first
+        {
+            item = q.items.back();
+            q.items.pop_back();
+        }
+        else  // Steal the least promising move of another thread
+        {
+            item = q.items.front();
+            q.items.pop_front();
+        }
+        return true;
+    }
+
+    return false;
+}
+
 Search::SearchManager* ThreadPool::main_manager() {
     return static_cast<Search::SearchManager*>(main_thread()->worker.get()->manager.get());
 }
@@ -134,71 +363,152 @@ Search::SearchManager* ThreadPool::main_manager() {
 uint64_t ThreadPool::nodes_searched() const { return accumulate(&Search::Worker::nodes); }
 uint64_t ThreadPool::tb_hits() const { return accumulate(&Search::Worker::tbHits); }
 
-// Creates/destroys threads to match the requested number.
+// Gathers the statistics of each thread since its worker was last cleared
+std::vector<Search::SearchStats> ThreadPool::search_stats() const {
+
+    std::vector<Search::SearchStats> stats;
+    for (auto&& th : threads)
+    {
+        const Search::Worker& w = *th->worker;
+        Search::SearchStats   s = w.stats;
+
+        s.ttProbes      = w.ttStats.probes;
+        s.ttHits        = w.ttStats.hits;
+        s.hotTTProbes   = w.ttStats.hotProbes;
+        s.hotTTHits     = w.ttStats.hotHits;
+        s.nnueRefreshes = w.refreshTable.big.refreshes + w.refreshTable.small.refreshes;
+        s.nnueUpdates   = w.refreshTable.big.updates + w.refreshTable.small.updates;
+        s.nnueDeferred  = w.refreshTable.big.deferred + w.refreshTable.small.deferred;
+        s.nnueSaved     = s.nnueDeferred - w.refreshTable.big.deferredComputed
+                        - w.refreshTable.small.deferredComputed;
+        s.waitTimeUs    = th->waitTimeUs.load(std::memory_order_relaxed);
+        stats.push_back(s);
+    }
+    return stats;
+}
+
+TTProbeStats ThreadPool::tt_probe_stats() const {
+
+    TTProbeStats sum;
+    for (auto&& th : threads)
+    {
+        const TTProbeStats& s = th->worker->ttStats;
+        sum.hotProbes += s.hotProbes;
+        sum.hotHits += s.hotHits;
+        sum.probes += s.probes;
+        sum.hits += s.hits;
+    }
+    return sum;
+}
+
+// Creates/destroys threads to match the requested number, usually the value
+// of the Threads option.
 // Created and launched threads will immediately go to sleep in idle_loop.
-// Upon resizing, threads are recreated to allow for binding if necessary.
+// Threads whose NUMA binding is unchanged are kept, together with their workers
+// and warm histories; only the workers of new threads are cleared.
 void ThreadPool::set(const NumaConfig&                           numaConfig,
                      Search::SharedState                         sharedState,
-                     const Search::SearchManager::UpdateContext& updateContext) {
+                     const Search::SearchManager::UpdateContext& updateContext,
+                     size_t                                      requested) {
 
-    if (threads.size() > 0)  // destroy any existing thread(s)
-    {
+    const TimePoint start = now();
+
+    if (threads.size() > 0)
         main_thread()->wait_for_search_finished();
 
-        threads.clear();
+    // Binding threads may be problematic when there's multiple NUMA nodes and
+    // multiple Stockfish instances running. In particular, if each instance
+    // runs a single thread then they would all be mapped to the first NUMA node.
+    // This is undesirable, and so the default behaviour (i.e. when the user does not
+    // change the NumaConfig UCI setting) is to not bind the threads to processors
+    // unless we know for sure that we span NUMA nodes and replication is required.
+    const std::string numaPolicy(sharedState.options["NumaPolicy"]);
+    const bool        doBindThreads = [&]() {
+        if (numaPolicy == "none")
+            return false;
+
+        if (numaPolicy == "auto")
+            return numaConfig.suggests_binding_threads(requested);
+
+        // numaPolicy == "system", or explicitly set by the user
+        return true;
+    }();
+
+    const std::vector<NumaIndex> binding =
+      doBindThreads ? numaConfig.distribute_threads_among_numa_nodes(requested)
+                    : std::vector<NumaIndex>{};
+    const std::vector<size_t> capacities =
+      doBindThreads ? numaConfig.distribute_threads_among_core_classes(binding)
+                    : std::vector<size_t>{};
+    const std::string bindingConfig = doBindThreads ? numaConfig.to_string() : std::string();
+
+    // A thread can be kept if it is bound to the same cores of the same config,
+    // or if it was not bound and is still not to be bound.
+    auto keep_thread = [&](size_t threadId) {
+        if (bindingConfig != boundNumaConfig || capacities.empty() != boundThreadToCapacity.empty())
+            return false;
+
+        return !doBindThreads
+            || (boundThreadToNumaNode[threadId] == binding[threadId]
+                && (capacities.empty() || boundThreadToCapacity[threadId] == capacities[threadId]));
+    };
 
-        boundThreadToNumaNode.clear();
-    }
+    while (threads.size() > requested)
+        threads.pop_back();
 
-    const size_t requested = sharedState.options["Threads"];
+    std::vector<size_t> created;
 
-    if (requested > 0)  // create new thread(s)
+    for (size_t threadId = 0; threadId < requested; ++threadId)
     {
-        // Binding threads may be problematic when there's multiple NUMA nodes and
-        // multiple Stockfish instances running. In particular, if each instance
-        // runs a single thread then they would all be mapped to the first NUMA node.
-        // This is undesirable, and so the default behaviour (i.e. when the user does not
-        // change the NumaConfig UCI setting) is to not bind the threads to processors
-        // unless we know for sure that we span NUMA nodes and replication is required.
-        const std::string numaPolicy(sharedState.options["NumaPolicy"]);
-        const bool        doBindThreads = [&]() {
-            if (numaPolicy == "none")
-                return false;
-
-            if (numaPolicy == "auto")
-                return numaConfig.suggests_binding_threads(requested);
-
-            // numaPolicy == "system", or explicitly set by the user
-            return true;
-        }();
-
-        boundThreadToNumaNode = doBindThreads
-                                ? numaConfig.distribute_threads_among_numa_nodes(requested)
-                                : std::vector<NumaIndex>{};
-
-        while (threads.size() < requested)
-        {
-            const size_t    threadId = threads.size();
-            const NumaIndex numaId   = doBindThreads ? boundThreadToNumaNode[threadId] : 0;
-            auto            manager  = threadId == 0 ? std::unique_ptr<Search::ISearchManager>(
-                             std::make_unique<Search::SearchManager>(updateContext))
-                                                     : std::make_unique<Search::NullSearchManager>();
-
-            // When not binding threads we want to force all access to happen
-            // from the same NUMA node, because in case of NUMA replicated memory
-            // accesses we don't want to trash cache in case the threads get scheduled
-            // on the same NUMA node.
-            auto binder = doBindThreads ? OptionalThreadToNumaNodeBinder(numaConfig, numaId)
-                                        : OptionalThreadToNumaNodeBinder(numaId);
-
-            threads.emplace_back(
-              std::make_unique<Thread>(sharedState, std::move(manager), threadId, binder));
-        }
+        if (threadId < threads.size() && keep_thread(threadId))
+            continue;
+
+        const NumaIndex numaId  = doBindThreads ? binding[threadId] : 0;
+        auto            manager = threadId == 0 ? std::unique_ptr<Search::ISearchManager>(
+                         std::make_unique<Search::SearchManager>(updateContext))
+                                                : std::make_unique<Search::NullSearchManager>();
+
+        // When not binding threads we want to force all access to happen
+        // from the same NUMA node, because in case of NUMA replicated memory
+        // accesses we don't want to trash cache in case the threads get scheduled
+        // on the same NUMA node.
+        // On hybrid CPUs the threads are also bound to a class of cores.
+        const size_t capacity = capacities.empty() ? 0 : capacities[threadId];
+        auto binder = doBindThreads ? OptionalThreadToNumaNodeBinder(numaConfig, numaId, capacity)
+                                    : OptionalThreadToNumaNodeBinder(numaId);
+
+        auto th = std::make_unique<Thread>(sharedState, std::move(manager), threadId, binder);
+
+        if (threadId < threads.size())
+            threads[threadId] = std::move(th);
+        else
+            threads.emplace_back(std::move(th));
+
+        created.push_back(threadId);
+    }
 
-        clear();
+    boundThreadToNumaNode = binding;
+    boundThreadToCapacity = capacities;
+    boundNumaConfig       = bindingConfig;
 
-        main_thread()->wait_for_search_finished();
-    }
+    // Clear the workers of the new threads in parallel, the kept ones only
+    // need their reductions to follow the new pool size.
+    for (size_t threadId = 0; threadId < threads.size(); ++threadId)
+        if (std::find(created.begin(), created.end(), threadId) == created.end())
+            threads[threadId]->worker->init_reductions();
+
+    for (size_t threadId : created)
+        threads[threadId]->clear_worker();
+
+    for (size_t threadId : created)
+        threads[threadId]->wait_for_search_finished();
+
+    if (!created.empty() && created.front() == 0)
+        clear_main_manager();
+
+    rootSplit.resize(threads.size());
+
+    resizeTime = now() - start;
 }
 
 
@@ -211,8 +521,27 @@ void ThreadPool::clear() {
         th->clear_worker();
 
     for (auto&& th : threads)
+    {
         th->wait_for_search_finished();
+        th->waitTimeUs.store(0, std::memory_order_relaxed);
+    }
+
+    clear_main_manager();
+}
 
+// Resizes the hot table of each thread, and clears it, on the thread itself so
+// that it is allocated locally. The shared table and the histories are kept.
+void ThreadPool::resize_hot_tt(size_t kb) {
+
+    for (auto&& th : threads)
+        th->run_custom_job([&w = *th->worker, kb]() { w.hotTT.resize(kb); });
+
+    for (auto&& th : threads)
+        th->wait_for_search_finished();
+}
+
+// Sets the search manager data to initial values
+void ThreadPool::clear_main_manager() {
     main_manager()->callsCnt                 = 0;
     main_manager()->bestPreviousScore        = VALUE_INFINITE;
     main_manager()->bestPreviousAverageScore = VALUE_INFINITE;
@@ -287,12 +616,18 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
             th->worker->rootPos.set(pos.fen(), pos.is_chess960(), &th->worker->rootState);
             th->worker->rootState = setupStates->back();
             th->worker->tbConfig  = tbConfig;
+            th->worker->start_deterministic(bool(options["Deterministic"]));
         });
     }
 
     for (auto&& th : threads)
         th->wait_for_search_finished();
 
+    // Without root moves the helper threads do not search, there is nothing to
+    // synchronize. Work stealing makes the search depend on the thread timings.
+    deterministic.start(bool(options["Deterministic"]) && !rootMoves.empty(), limits.nodes);
+    rootSplit.enable(bool(options["RootSplit"]) && !deterministic.enabled());
+
     main_thread()->start_searching();
 }
 
@@ -308,9 +643,13 @@ Thread* ThreadPool::get_best_thread() const {
     for (auto&& th : threads)
         minScore = std::min(minScore, th->worker->rootMoves[0].score);
 
-    // Vote according to score and depth, and select the best thread
-    auto thread_voting_value = [minScore](Thread* th) {
-        return (th->worker->rootMoves[0].score - minScore + 14) * int(th->worker->completedDepth);
+    // Vote according to score and depth, and select the best thread. On hybrid
+    // CPUs the votes of threads on slower cores, whose shallower results would
+    // otherwise count as much, are scaled down by their relative capacity.
+    auto thread_voting_value = [this, minScore](Thread* th) {
+        return int64_t(th->worker->rootMoves[0].score - minScore + 14)
+             * int(th->worker->completedDepth) * int64_t(core_capacity(th->id()))
+             / int64_t(MAX_CPU_CAPACITY);
     };
 
     for (auto&& th : threads)
@@ -363,6 +702,19 @@ Thread* ThreadPool::get_best_thread() const {
 }
 
 
+void ThreadPool::notify_stop_or_ponderhit() {
+
+    { std::lock_guard<std::mutex> lk(stopMutex); }
+    stopCv.notify_all();
+    stopTimer.wake();
+}
+
+void ThreadPool::wait_for_stop_or_ponderhit(const std::function<bool()>& keepWaiting) {
+
+    std::unique_lock<std::mutex> lk(stopMutex);
+    stopCv.wait(lk, [&] { return !keepWaiting(); });
+}
+
 // Start non-main threads
 // Will be invoked by main thread after it has started searching
 void ThreadPool::start_searching() {
@@ -401,4 +753,15 @@ std::vector<size_t> ThreadPool::get_bound_thread_count_by_numa_node() const {
     return counts;
 }
 
+// Pairs of core capacity and number of threads bound to cores of this class,
+// fastest first. Empty unless the threads are bound on a hybrid CPU.
+std::vector<std::pair<size_t, size_t>> ThreadPool::get_bound_thread_count_by_capacity() const {
+    std::map<size_t, size_t, std::greater<size_t>> counts;
+
+    for (size_t capacity : boundThreadToCapacity)
+        counts[capacity] += 1;
+
+    return {counts.begin(), counts.end()};
+}
+
 }  // namespace Stockfish
@@ -23,11 +23,14 @@
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 #include <functional>
 
+#include "misc.h"
 #include "position.h"
 #include "search.h"
 #include "thread_win32_osx.h"
@@ -49,13 +52,14 @@ class OptionalThreadToNumaNodeBinder {
         numaConfig(nullptr),
         numaId(n) {}
 
-    OptionalThreadToNumaNodeBinder(const NumaConfig& cfg, NumaIndex n) :
+    OptionalThreadToNumaNodeBinder(const NumaConfig& cfg, NumaIndex n, size_t capacity = 0) :
         numaConfig(&cfg),
-        numaId(n) {}
+        numaId(n),
+        cpuCapacity(capacity) {}
 
     NumaReplicatedAccessToken operator()() const {
         if (numaConfig != nullptr)
-            return numaConfig->bind_current_thread_to_numa_node(numaId);
+            return numaConfig->bind_current_thread_to_numa_node(numaId, cpuCapacity);
         else
             return NumaReplicatedAccessToken(numaId);
     }
@@ -63,6 +67,7 @@ class OptionalThreadToNumaNodeBinder {
    private:
     const NumaConfig* numaConfig;
     NumaIndex         numaId;
+    size_t            cpuCapacity = 0;
 };
 
 // Abstraction of a thread. It contains a pointer to the worker and a native thread.
@@ -91,25 +96,123 @@ class Thread {
     void   wait_for_search_finished();
     size_t id() const { return idx; }
 
-    std::unique_ptr<Search::Worker> worker;
-    std::function<void()>           jobFunc;
+    LargePagePtr<Search::Worker> worker;
+    std::function<void()>        jobFunc;
+
+    // Time spent by callers of wait_for_search_finished(), see SearchStatsEnabled.
+    // Atomic as the callers, the statistics report and the reset can be on
+    // different threads.
+    std::atomic<uint64_t> waitTimeUs = 0;
 
    private:
     std::mutex                mutex;
     std::condition_variable   cv;
-    size_t                    idx, nthreads;
+    size_t                    idx;
     bool                      exit = false, searching = true;  // Set before starting std::thread
     NativeThread              stdThread;
     NumaReplicatedAccessToken numaAccessToken;
 };
 
 
+// Work-stealing scheduler used with the RootSplit option. At each iteration the
+// main thread publishes the root moves of the next depth as work items, spread
+// over one deque per helper thread. A helper pops its own items from the back
+// and, once they are exhausted, steals from the front of the other deques.
+// Helpers without work fall back to their usual Lazy SMP iterations.
+class RootSplitScheduler {
+   public:
+    struct Item {
+        Depth depth;
+        Move  move;
+    };
+
+    void resize(size_t threadCount);
+    void enable(bool on);
+    bool enabled() const { return active; }
+
+    void publish(Depth depth, const Search::RootMoves& rootMoves);
+    bool take(size_t threadIdx, Item& item);
+
+   private:
+    struct alignas(64) WorkQueue {
+        std::mutex       mutex;
+        std::deque<Item> items;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues;
+    bool                                    active = false;
+};
+
+
+// Ends time-limited searches on time. Once the first iteration is complete the
+// main thread arms the timer with the hard deadline of the search, and the timer
+// thread raises the stop signal when it is reached. So the latency from the
+// deadline to the bestmove no longer depends on how often the main thread gets
+// to poll the clock, which can be rare on an overloaded machine. The periodic
+// check_time() still handles the other limits. The thread is started on first use.
+class StopTimer {
+   public:
+    explicit StopTimer(ThreadPool& pool) :
+        threads(pool) {}
+    ~StopTimer();
+
+    void arm(TimePoint deadline);
+    void disarm();
+    void wake();  // Re-evaluates the stop conditions, e.g. after a ponderhit
+
+   private:
+    void idle_loop();
+
+    ThreadPool&                   threads;
+    std::mutex                    mutex;
+    std::condition_variable       cv;
+    TimePoint                     deadline = 0;
+    bool                          armed = false, exit = false;
+    std::unique_ptr<NativeThread> timerThread;
+};
+
+
+// Synchronizes the threads in the deterministic SMP mode. Each thread stops at
+// every Quantum nodes it has searched, and the last one to arrive commits the
+// transposition table logs of all the threads in index order, see TTCommitLog.
+// The stops for a node limit or for a finished main thread are only raised at
+// a synchronization point, so that every thread stops at the same node count
+// in every run. A thread which has finished its iterative deepening leaves
+// through finish(), the others then synchronize without it.
+class DeterministicSync {
+   public:
+    static constexpr uint64_t Quantum = 4096;
+
+    explicit DeterministicSync(ThreadPool& pool) :
+        threads(pool) {}
+
+    void start(bool on, uint64_t nodes);
+    bool enabled() const { return active; }
+
+    void sync();
+    void finish(bool endSearch);
+    void stop();
+
+   private:
+    void complete_phase();
+
+    ThreadPool&             threads;
+    std::mutex              mutex;
+    std::condition_variable cv;
+    bool                    active = false, stopRequested = false;
+    uint64_t                nodeLimit = 0, phase = 0;
+    size_t                  arrived = 0, participants = 0;
+};
+
+
 // ThreadPool struct handles all the threads-related stuff like init, starting,
 // parking and, most importantly, launching a thread. All the access to threads
 // is done through this class.
 class ThreadPool {
    public:
-    ThreadPool() {}
+    ThreadPool() :
+        stopTimer(*this),
+        deterministic(*this) {}
 
     ~ThreadPool() {
         // destroy any existing thread(s)
@@ -132,21 +235,44 @@ class ThreadPool {
     void   wait_on_thread(size_t threadId);
     size_t num_threads() const;
     void   clear();
+    void   resize_hot_tt(size_t kb);
     void   set(const NumaConfig& numaConfig,
                Search::SharedState,
-               const Search::SearchManager::UpdateContext&);
+               const Search::SearchManager::UpdateContext&,
+               size_t requested);
 
     Search::SearchManager* main_manager();
     Thread*                main_thread() const { return threads.front().get(); }
     uint64_t               nodes_searched() const;
     uint64_t               tb_hits() const;
+    TTProbeStats           tt_probe_stats() const;
     Thread*                get_best_thread() const;
     void                   start_searching();
     void                   wait_for_search_finished() const;
 
-    std::vector<size_t> get_bound_thread_count_by_numa_node() const;
+    std::vector<size_t>                    get_bound_thread_count_by_numa_node() const;
+    std::vector<std::pair<size_t, size_t>> get_bound_thread_count_by_capacity() const;
+    std::vector<Search::SearchStats>       search_stats() const;
+
+    // To be called after stop or ponder changed outside of the search threads,
+    // wakes up the stop timer and the main thread if it waits for them.
+    void notify_stop_or_ponderhit();
+    // Blocks the calling thread while keepWaiting() holds, it is checked again
+    // at each call to notify_stop_or_ponderhit().
+    void wait_for_stop_or_ponderhit(const std::function<bool()>& keepWaiting);
 
-    std::atomic_bool stop, abortedSearch, increaseDepth;
+    // Time taken by the last call to set()
+    TimePoint resize_time() const { return resizeTime; }
+
+    // Relative performance of the cores the given thread is bound to, on hybrid CPUs
+    size_t core_capacity(size_t threadId) const {
+        return boundThreadToCapacity.empty() ? MAX_CPU_CAPACITY : boundThreadToCapacity[threadId];
+    }
+
+    std::atomic_bool   stop, abortedSearch, increaseDepth;
+    RootSplitScheduler rootSplit;
+    StopTimer          stopTimer;
+    DeterministicSync  deterministic;
 
     auto cbegin() const noexcept { return threads.cbegin(); }
     auto begin() noexcept { return threads.begin(); }
@@ -159,6 +285,13 @@ class ThreadPool {
     StateListPtr                         setupStates;
     std::vector<std::unique_ptr<Thread>> threads;
     std::vector<NumaIndex>               boundThreadToNumaNode;
+    std::vector<size_t>                  boundThreadToCapacity;
+    std::string                          boundNumaConfig;
+    TimePoint                            resizeTime = 0;
+    std::mutex                           stopMutex;
+    std::condition_variable              stopCv;
+
+    void clear_main_manager();
 
     uint64_t accumulate(std::atomic<uint64_t> Search::Worker::*member) const {
 
@@ -18,47 +18,193 @@
 
 #include "tt.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include "misc.h"
+#include "numa.h"
 #include "syzygy/tbprobe.h"
 #include "thread.h"
 
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
 namespace Stockfish {
 
+namespace {
+
+// A transposition table snapshot file starts with this header, followed by
+// the raw cluster array. The header is padded to SnapshotHeaderSize bytes, a
+// multiple of the page size on all supported systems, so that the clusters can
+// be memory-mapped straight from the file without a parsing pass. Snapshots
+// are stored in native byte order and are not meant to be moved across
+// platforms.
+struct SnapshotHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t clusterBytes;
+    uint32_t clusterEntries;
+    uint64_t clusterCount;
+    uint64_t checksum;
+    uint8_t  generation8;
+    int64_t  occupancy[TTOccupancy::Generations];  // Entries per generation, for hashfull
+};
+
+constexpr char     SnapshotMagic[8]   = {'S', 'F', 'T', 'T', 'S', 'N', 'A', 'P'};
+constexpr uint32_t SnapshotVersion    = 3;
+constexpr size_t   SnapshotHeaderSize = 64 * 1024;
+constexpr uint64_t SnapshotSamples    = 4096;
+
+static_assert(sizeof(SnapshotHeader) <= SnapshotHeaderSize);
+
+// FNV-1a over 64-bit words
+uint64_t fnv1a(const void* mem, size_t size, uint64_t hash = 14695981039346656037ULL) {
+
+    const uint64_t* data = static_cast<const uint64_t*>(mem);
+
+    for (size_t i = 0; i < size / sizeof(uint64_t); ++i)
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+
+    return hash;
+}
+
+// Checksum used to reject stale or corrupt snapshots, over the header fields
+// and SnapshotSamples clusters spread evenly over the table. Hashing all the
+// clusters would read the whole file before the table is first used.
+uint64_t snapshot_checksum(const SnapshotHeader& header, const void* clusters) {
+
+    const uint64_t fields[] = {header.version, header.clusterBytes, header.clusterEntries,
+                               header.clusterCount, header.generation8};
+
+    uint64_t hash = fnv1a(fields, sizeof(fields));
+    hash          = fnv1a(header.occupancy, sizeof(header.occupancy), hash);
+
+    const char*    data   = static_cast<const char*>(clusters);
+    const uint64_t stride = std::max(header.clusterCount / SnapshotSamples, uint64_t(1));
+
+    for (uint64_t i = 0; i < header.clusterCount; i += stride)
+        hash = fnv1a(data + i * header.clusterBytes, header.clusterBytes, hash);
+
+    return hash;
+}
+
+constexpr uint32_t SharedMagic = 0x53465453;  // "SFTS"
+
+// The header of a shared table is padded to SharedHeaderSize bytes, which keeps
+// the clusters aligned to large pages.
+constexpr size_t SharedHeaderSize = 2 * 1024 * 1024;
+
+// How long to wait for another process to finish creating a shared table
+constexpr TimePoint SharedAttachTimeout = 10000;
+
+}  // namespace
+
+// A shared transposition table is a POSIX shared memory object, holding this
+// header followed by the cluster array. The process creating the object fills
+// in the header and publishes it by setting 'ready'. The other processes wait
+// for this before they check that the layout matches their own and attach.
+struct SharedTTHeader {
+    std::atomic<uint32_t> ready;
+    std::atomic<uint32_t> processes;    // Number of processes attached
+    std::atomic<uint8_t>  generation8;  // Generation of the latest search of any process
+    uint32_t              clusterBytes;
+    uint32_t              clusterEntries;
+    uint64_t              clusterCount;
+};
+
+static_assert(sizeof(SharedTTHeader) <= SharedHeaderSize);
+static_assert(std::atomic<uint32_t>::is_always_lock_free
+                && std::atomic<uint8_t>::is_always_lock_free,
+              "Atomics in shared memory must not depend on a process-local lock");
+
 // DEPTH_ENTRY_OFFSET exists because 1) we use `bool(depth8)` as the occupancy check, but
 // 2) we need to store negative depths for QS. (`depth8` is the only field with "spare bits":
 // we sacrifice the ability to store depths greater than 1<<8 less the offset, as asserted below.)
 
 // Populates the TTEntry with a new node's data, possibly
 // overwriting an old position. The update is not atomic and can be racy.
-void TTEntry::save(
-  Key k, Value v, bool pv, Bound b, Depth d, Move m, Value ev, uint8_t generation8) {
+// The occupancy of the calling thread is updated for the generation change.
+void TTEntry::save(Key          k,
+                   Value        v,
+                   bool         pv,
+                   Bound        b,
+                   Depth        d,
+                   Move         m,
+                   Value        ev,
+                   uint8_t      generation8,
+                   int          slot,
+                   TTOccupancy& occupancy) {
+
+    const bool sameKey = uint16_t(k) == key();
 
     // Preserve the old ttmove if we don't have a new one
-    if (m || uint16_t(k) != key16)
+    if (m || !sameKey)
         move16 = m;
 
-    // Overwrite less valuable entries (cheapest checks first)
-    if (b == BOUND_EXACT || uint16_t(k) != key16 || d - DEPTH_ENTRY_OFFSET + 2 * pv > depth8 - 4
-        || relative_age(generation8))
+    // Overwrite less valuable entries, as decided by the replacement policy
+    if (TranspositionTable::ReplacementPolicy::overwrite(*this, sameKey, b, d, pv, generation8,
+                                                         slot))
     {
         assert(d > DEPTH_ENTRY_OFFSET);
         assert(d < 256 + DEPTH_ENTRY_OFFSET);
 
-        key16     = uint16_t(k);
+        constexpr unsigned GenerationShift = TranspositionTable::GENERATION_BITS;
+
+        if (depth8)
+            occupancy.add(genBound8 >> GenerationShift, -1);
+        occupancy.add(generation8 >> GenerationShift, 1);
+
+#ifndef TT_VERIFY
+        key16 = uint16_t(k);
+#endif
         depth8    = uint8_t(d - DEPTH_ENTRY_OFFSET);
         genBound8 = uint8_t(generation8 | uint8_t(pv) << 2 | b);
         value16   = int16_t(v);
         eval16    = int16_t(ev);
     }
+
+#ifdef TT_VERIFY
+    // The stored key covers the data, and probe() computes data_hash() again
+    // from the data it reads. An entry read in the middle of a save, or mixing
+    // the stores of two writers, only passes the check with the odds of a random
+    // 16 bit match, whatever the order in which the compiler or the processor
+    // makes the stores visible, so no order is needed.
+    key16 = uint16_t(k) ^ data_hash();
+#endif
 }
 
 
+#ifdef TT_VERIFY
+
+// Folds the 8 bytes following the key into 16 bits
+uint16_t TTEntry::data_hash() const {
+
+    static_assert(sizeof(TTEntry) == sizeof(key16) + sizeof(uint64_t));
+
+    uint64_t data;
+    std::memcpy(&data, reinterpret_cast<const char*>(this) + sizeof(key16), sizeof(data));
+
+    data ^= data >> 32;
+    data ^= data >> 16;
+    return uint16_t(data);
+}
+
+#endif
+
+
 uint8_t TTEntry::relative_age(const uint8_t generation8) const {
     // Due to our packed storage format for generation and its cyclic
     // nature we add GENERATION_CYCLE (256 is the modulus, plus what
@@ -74,82 +220,571 @@ uint8_t TTEntry::relative_age(const uint8_t generation8) const {
 // Sets the size of the transposition table,
 // measured in megabytes. Transposition table consists
 // of clusters and each cluster consists of ClusterSize number of TTEntry.
-void TranspositionTable::resize(size_t mbSize, ThreadPool& threads) {
-    aligned_large_pages_free(table);
+// If sharedName is not empty, the table is placed in the shared memory object
+// of that name, which is created if no other process uses it yet.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+void ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::resize(
+  size_t mbSize, ThreadPool& threads, const std::string& sharedName) {
+    const TimePoint start = now();
+
+    free_table();
 
     clusterCount = mbSize * 1024 * 1024 / sizeof(Cluster);
 
-    table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
-    if (!table)
+    bool created = true;
+
+    if (sharedName.empty() || !attach_shared(sharedName, created))
+    {
+        created = true;
+        table = static_cast<Cluster*>(aligned_large_pages_alloc(clusterCount * sizeof(Cluster)));
+        if (!table)
+        {
+            std::cerr << "Failed to allocate " << mbSize << "MB for transposition table."
+                      << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // A table we attached to already holds the results of the other processes
+    if (created)
+        clear(threads);
+    else
+    {
+        occupancies.assign(threads.num_threads(), TTOccupancy{});
+        count_occupancy();
+    }
+
+    allocationTime = now() - start;
+}
+
+
+// Maps the table from the shared memory object with the given name. Sets
+// created if this process made the object, otherwise the object must have the
+// same size and cluster layout as this table. Returns false on failure.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+bool ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::attach_shared(
+  const std::string& name, bool& created) {
+
+#if !defined(_WIN32) && !defined(__ANDROID__)
+
+    const std::string path = name[0] == '/' ? name : "/" + name;
+    const size_t      size = SharedHeaderSize + clusterCount * sizeof(Cluster);
+
+    int fd  = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    created = fd != -1;
+
+    if (!created)
+        fd = shm_open(path.c_str(), O_RDWR, 0);
+
+    if (fd == -1 || (created && ftruncate(fd, off_t(size)) != 0))
+    {
+        if (fd != -1)
+        {
+            ::close(fd);
+            shm_unlink(path.c_str());
+        }
+        sync_cout << "info string Could not create shared memory object " << path << sync_endl;
+        return false;
+    }
+
+    // The creator may not have set the size of the object yet
+    const TimePoint waitStart = now();
+    struct stat     st;
+
+    while (!created && fstat(fd, &st) == 0 && st.st_size == 0
+           && now() - waitStart < SharedAttachTimeout)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    if (!created && (fstat(fd, &st) != 0 || size_t(st.st_size) != size))
+    {
+        ::close(fd);
+        sync_cout << "info string Shared memory object " << path
+                  << " was created with a different Hash size" << sync_endl;
+        return false;
+    }
+
+    void* mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mem == MAP_FAILED)
     {
-        std::cerr << "Failed to allocate " << mbSize << "MB for transposition table." << std::endl;
-        exit(EXIT_FAILURE);
+        if (created)
+            shm_unlink(path.c_str());
+        sync_cout << "info string Could not mmap() shared memory object " << path << sync_endl;
+        return false;
     }
 
-    clear(threads);
+    #if defined(MADV_HUGEPAGE)
+    madvise(mem, size, MADV_HUGEPAGE);
+    #endif
+
+    SharedTTHeader* header = static_cast<SharedTTHeader*>(mem);
+
+    // The object is zero-filled on creation, so the table is already empty
+    if (created)
+    {
+        header->clusterBytes   = ClusterBytes;
+        header->clusterEntries = ClusterSize;
+        header->clusterCount   = clusterCount;
+        header->generation8    = generation8;
+        header->processes      = 1;
+        header->ready          = SharedMagic;
+    }
+    else
+    {
+        while (header->ready != SharedMagic && now() - waitStart < SharedAttachTimeout)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        if (header->ready != SharedMagic || header->clusterBytes != ClusterBytes
+            || header->clusterEntries != ClusterSize || header->clusterCount != clusterCount)
+        {
+            munmap(mem, size);
+            sync_cout << "info string Shared memory object " << path
+                      << " has an incompatible transposition table layout" << sync_endl;
+            return false;
+        }
+
+        ++header->processes;
+        generation8 = header->generation8;
+    }
+
+    table      = reinterpret_cast<Cluster*>(static_cast<char*>(mem) + SharedHeaderSize);
+    shared     = header;
+    sharedPath = path;
+    mappedSize = size;
+
+    sync_cout << "info string Transposition table " << (created ? "created in " : "attached to ")
+              << "shared memory object " << path << sync_endl;
+    return true;
+
+#else
+
+    (void) created;
+    sync_cout << "info string Shared transposition table " << name
+              << " is not supported on this platform" << sync_endl;
+    return false;
+
+#endif
+}
+
+
+// Starts a new search by advancing the generation of the table. With a shared
+// table the first process to start a new search advances the common generation
+// and the others adopt it, so that processes searching side by side age the
+// entries once per search and not once per process.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+void ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::new_search() {
+
+    // increment by delta to keep lower bits as is
+    const uint8_t next = generation8 + GENERATION_DELTA;
+
+    // On failure generation8 is set to the current shared generation
+    if (shared && !shared->generation8.compare_exchange_strong(generation8, next))
+        return;
+
+    generation8 = next;
 }
 
 
 // Initializes the entire transposition table to zero,
 // in a multi-threaded way.
-void TranspositionTable::clear(ThreadPool& threads) {
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+void ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::clear(
+  ThreadPool& threads) {
+
+    // A shared table is left alone while other processes may be searching
+    if (shared && shared->processes > 1)
+        return;
+
     const size_t threadCount = threads.num_threads();
 
     for (size_t i = 0; i < threadCount; ++i)
     {
         threads.run_on_thread(i, [this, i, threadCount]() {
-            // Each thread will zero its part of the hash table
-            const size_t stride = clusterCount / threadCount;
-            const size_t start  = stride * i;
-            const size_t len    = i + 1 != threadCount ? stride : clusterCount - start;
-
-            std::memset(&table[start], 0, len * sizeof(Cluster));
+            // Each thread will zero its part of the hash table. After a resize
+            // this is the first touch of the memory, so the parts are made of
+            // whole large pages: each page is then placed on the NUMA node of
+            // the (possibly bound) thread that clears it.
+            constexpr size_t PageClusters = 2 * 1024 * 1024 / sizeof(Cluster);
+
+            const size_t pages     = (clusterCount + PageClusters - 1) / PageClusters;
+            const size_t firstPage = pages * i / threadCount;
+            const size_t lastPage  = pages * (i + 1) / threadCount;
+            const size_t start     = std::min(clusterCount, firstPage * PageClusters);
+            const size_t end       = std::min(clusterCount, lastPage * PageClusters);
+
+            std::memset(&table[start], 0, (end - start) * sizeof(Cluster));
         });
     }
 
     for (size_t i = 0; i < threadCount; ++i)
         threads.wait_on_thread(i);
+
+    occupancies.assign(threadCount, TTOccupancy{});
+}
+
+
+// Keeps the table and its contents for a resized thread pool. The occupancy
+// counters of the removed threads are added to those of the first one.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+void ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::set_thread_count(
+  size_t threadCount) {
+
+    assert(threadCount > 0);
+
+    for (size_t i = threadCount; i < occupancies.size(); ++i)
+        for (int g = 0; g < TTOccupancy::Generations; ++g)
+            occupancies[0].add(g, occupancies[i].count(g));
+
+    occupancies.resize(threadCount, TTOccupancy{});
+    allocationTime = 0;
+}
+
+
+// Returns how many of the sampled pages of the table reside on each NUMA node
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+std::vector<size_t>
+ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::page_count_by_numa_node()
+  const {
+    return get_page_count_by_numa_node(table, clusterCount * sizeof(Cluster));
+}
+
+
+// Releases the cluster array, which is either a regular allocation, a private
+// mapping of a snapshot file or a shared memory object. The last process to
+// detach from a shared memory object removes it.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+void ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::free_table() {
+
+#ifndef _WIN32
+    if (shared)
+    {
+    #ifndef __ANDROID__
+        if (--shared->processes == 0)
+            shm_unlink(sharedPath.c_str());
+    #endif
+        munmap(shared, mappedSize);
+    }
+    else if (mappedSize)
+        munmap(table, mappedSize);
+    else
+#endif
+        aligned_large_pages_free(table);
+
+    table      = nullptr;
+    shared     = nullptr;
+    mappedSize = 0;
+}
+
+
+// Writes the whole table, together with the current generation, to a
+// snapshot file that can later be restored with load_from_file().
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+bool ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::save_to_file(
+  const std::string& filename) const {
+
+    const size_t size = clusterCount * sizeof(Cluster);
+
+    std::vector<char> headerBuf(SnapshotHeaderSize, 0);
+    SnapshotHeader    header{};
+
+    std::memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+    header.version      = SnapshotVersion;
+    header.clusterBytes   = sizeof(Cluster);
+    header.clusterEntries = ClusterSize;
+    header.clusterCount   = clusterCount;
+    header.generation8    = generation8;
+
+    for (const TTOccupancy& occupancy : occupancies)
+        for (int g = 0; g < TTOccupancy::Generations; ++g)
+            header.occupancy[g] += occupancy.count(g);
+
+    header.checksum = snapshot_checksum(header, table);
+    std::memcpy(headerBuf.data(), &header, sizeof(header));
+
+    std::ofstream stream(filename, std::ios::binary);
+    stream.write(headerBuf.data(), headerBuf.size());
+    stream.write(reinterpret_cast<const char*>(table), size);
+    stream.close();
+
+    if (!stream)
+    {
+        sync_cout << "info string Failed to save transposition table to " << filename
+                  << sync_endl;
+        return false;
+    }
+
+    sync_cout << "info string Transposition table saved to " << filename << sync_endl;
+    return true;
+}
+
+
+// Replaces the table with the contents of a snapshot file written by
+// save_to_file(). The file must have been saved with the same Hash size and
+// cluster layout. Where mmap() is available the clusters are mapped privately
+// from the file, so pages are faulted in lazily and copied only on write, and
+// neither the checksum nor the occupancy needs a pass over the whole table.
+// The mapping uses 4 KB pages instead of large pages, so until the next resize
+// the probes of the search miss the TLB more often, and the first write to each
+// page copies it.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+bool ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::load_from_file(
+  const std::string& filename) {
+
+    if (shared)
+    {
+        sync_cout << "info string Snapshots cannot be loaded into a shared transposition table"
+                  << sync_endl;
+        return false;
+    }
+
+    const size_t   size = clusterCount * sizeof(Cluster);
+    SnapshotHeader header{};
+    std::ifstream  stream(filename, std::ios::binary | std::ios::ate);
+
+    const auto fileSize = stream.tellg();
+    stream.seekg(0);
+
+    if (!stream.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || std::memcmp(header.magic, SnapshotMagic, sizeof(header.magic))
+        || header.version != SnapshotVersion || header.clusterBytes != sizeof(Cluster)
+        || header.clusterEntries != ClusterSize)
+    {
+        sync_cout << "info string " << filename
+                  << " is not a compatible transposition table snapshot" << sync_endl;
+        return false;
+    }
+
+    if (header.clusterCount != clusterCount || size_t(fileSize) != SnapshotHeaderSize + size)
+    {
+        sync_cout << "info string Transposition table snapshot " << filename
+                  << " does not match the current Hash size" << sync_endl;
+        return false;
+    }
+
+#ifndef _WIN32
+    stream.close();
+
+    int   fd  = ::open(filename.c_str(), O_RDONLY);
+    void* mem = fd == -1 ? MAP_FAILED
+                         : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                                off_t(SnapshotHeaderSize));
+    if (fd != -1)
+        ::close(fd);
+
+    if (mem == MAP_FAILED)
+    {
+        sync_cout << "info string Could not mmap() " << filename << sync_endl;
+        return false;
+    }
+
+    #if defined(MADV_WILLNEED)
+    madvise(mem, size, MADV_WILLNEED);
+    #endif
+#else
+    void* mem = aligned_large_pages_alloc(size);
+
+    stream.seekg(SnapshotHeaderSize);
+    if (!mem || !stream.read(static_cast<char*>(mem), size))
+    {
+        aligned_large_pages_free(mem);
+        sync_cout << "info string Failed to read " << filename << sync_endl;
+        return false;
+    }
+#endif
+
+    if (snapshot_checksum(header, mem) != header.checksum)
+    {
+#ifndef _WIN32
+        munmap(mem, size);
+#else
+        aligned_large_pages_free(mem);
+#endif
+        sync_cout << "info string Checksum mismatch in transposition table snapshot " << filename
+                  << sync_endl;
+        return false;
+    }
+
+    free_table();
+
+    table       = static_cast<Cluster*>(mem);
+    generation8 = header.generation8;
+#ifndef _WIN32
+    mappedSize = size;
+#endif
+
+    occupancies.assign(std::max(occupancies.size(), size_t(1)), TTOccupancy{});
+    for (int g = 0; g < TTOccupancy::Generations; ++g)
+        occupancies[0].add(g, header.occupancy[g]);
+
+    sync_cout << "info string Transposition table loaded from " << filename << sync_endl;
+    return true;
 }
 
 
 // Looks up the current position in the transposition
 // table. It returns true and a pointer to the TTEntry if the position is found.
 // Otherwise, it returns false and a pointer to an empty or least valuable TTEntry
-// to be replaced later. The replace value of an entry is calculated as its depth
-// minus 8 times its relative age. TTEntry t1 is considered more valuable than
-// TTEntry t2 if its replace value is greater than that of t2.
-TTEntry* TranspositionTable::probe(const Key key, bool& found) const {
+// to be replaced later, as chosen by the replacement policy of the table.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+TTEntry* ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::probe(
+  const Key key, bool& found) const {
+    return probe_cluster(first_entry(key), key, found, generation8);
+}
+
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+TTEntry* ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::probe_cluster(
+  TTEntry* tte, const Key key, bool& found, uint8_t generation8) {
 
-    TTEntry* const tte   = first_entry(key);
     const uint16_t key16 = uint16_t(key);  // Use the low 16 bits as key inside the cluster
 
     for (int i = 0; i < ClusterSize; ++i)
-        if (tte[i].key16 == key16 || !tte[i].depth8)
+        if (tte[i].key() == key16 || !tte[i].depth8)
             return found = bool(tte[i].depth8), &tte[i];
 
     // Find an entry to be replaced according to the replacement strategy
-    TTEntry* replace = tte;
-    for (int i = 1; i < ClusterSize; ++i)
-        if (replace->depth8 - replace->relative_age(generation8) * 2
-            > tte[i].depth8 - tte[i].relative_age(generation8) * 2)
-            replace = &tte[i];
-
-    return found = false, replace;
+    return found = false, Replacement::victim(tte, ClusterSize, key, generation8);
 }
 
 
 // Returns an approximation of the hashtable
 // occupation during a search. The hash is x permill full, as per UCI protocol.
 // Only counts entries which match the current generation.
-int TranspositionTable::hashfull() const {
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+int ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::hashfull() const {
+    return hashfull_by_age(1)[0];
+}
 
-    int cnt = 0;
-    for (int i = 0; i < 1000; ++i)
+
+// Returns, for each age from 0 (the current search) up to ages - 1, the permill
+// of the table taken by entries written that many searches ago. The counts are
+// merged from the per-thread occupancies, so the table itself is not accessed.
+// Concurrent writers to the same entry may both account for it, which makes the
+// result approximate while a search is running.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+std::vector<int>
+ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::hashfull_by_age(
+  int ages) const {
+
+    constexpr int Generations = TTOccupancy::Generations;
+
+    int64_t entries[Generations] = {};
+    for (const TTOccupancy& occupancy : occupancies)
+        for (int g = 0; g < Generations; ++g)
+            entries[g] += occupancy.count(g);
+
+    const int64_t    total = int64_t(clusterCount) * ClusterSize;
+    std::vector<int> permill(ages, 0);
+
+    for (int age = 0; total && age < std::min(ages, Generations); ++age)
+    {
+        const int g  = ((generation8 >> GENERATION_BITS) - age) & (Generations - 1);
+        permill[age] = int(std::clamp<int64_t>(entries[g] * 1000 / total, 0, 1000));
+    }
+
+    return permill;
+}
+
+
+// Rebuilds the occupancy from the table contents, for when the table is filled
+// by other means than TTEntry::save(). The whole count is put on the first thread.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+void ClusteredTranspositionTable<ClusterSize, ClusterBytes, Replacement>::count_occupancy() {
+
+    occupancies.assign(std::max(occupancies.size(), size_t(1)), TTOccupancy{});
+
+    for (size_t i = 0; i < clusterCount; ++i)
         for (int j = 0; j < ClusterSize; ++j)
-            cnt += table[i].entry[j].depth8
-                && (table[i].entry[j].genBound8 & GENERATION_MASK) == generation8;
+            if (table[i].entry[j].depth8)
+                occupancies[0].add(table[i].entry[j].genBound8 >> GENERATION_BITS, 1);
+}
+
+template class ClusteredTranspositionTable<3, 32, TTReplacementPolicy>;
+template class ClusteredTranspositionTable<6, 64, TTReplacementPolicy>;
+
+
+void TTCommitLog::resize(uint64_t quantum) {
+
+    size_t size = 1;
+    while (size < 8 * quantum)
+        size *= 2;
+
+    slots.assign(size, Slot{});
+    touched.clear();
+    touched.reserve(size / 2);
+    epoch     = 1;
+    occupancy = TTOccupancy{};
+}
+
+void TTCommitLog::start() {
+
+    touched.clear();
+
+    if (++epoch == 0)
+    {
+        for (Slot& s : slots)
+            s.epoch = 0;
+        epoch = 1;
+    }
+}
+
+// Returns the entry of the key in the copy of its cluster, which is first taken
+// from the table if the cluster has not been probed since the last commit. The
+// log is an open addressing hash table of clusters, so that a slot is never
+// given to another cluster before the commit.
+TTEntry* TTCommitLog::probe(const TranspositionTable& tt, const Key key, bool& found) {
+
+    const size_t cluster = mul_hi64(key, tt.clusterCount);
+    const size_t mask    = slots.size() - 1;
+    size_t       idx     = cluster & mask;
+
+    while (slots[idx].epoch == epoch && slots[idx].cluster != cluster)
+        idx = (idx + 1) & mask;
+
+    Slot& s = slots[idx];
+
+    if (s.epoch != epoch)
+    {
+        assert(touched.size() < slots.size() / 2);
+
+        s.data = s.original = tt.table[cluster];
+        s.cluster           = cluster;
+        s.epoch             = epoch;
+        touched.push_back(idx);
+    }
+
+    return TranspositionTable::probe_cluster(s.data.entry, key, found, tt.generation());
+}
+
+// Writes the entries modified since the last commit back to the table. An entry
+// also modified by a thread committed earlier is overwritten, as in the shared
+// table the last writer wins.
+void TTCommitLog::commit(TranspositionTable& tt, TTOccupancy& occ) {
+
+    constexpr unsigned GenerationShift = TranspositionTable::GENERATION_BITS;
+
+    for (size_t idx : touched)
+    {
+        const Slot& s = slots[idx];
+
+        for (size_t i = 0; i < std::size(s.data.entry); ++i)
+        {
+            const TTEntry& e = s.data.entry[i];
+            TTEntry&       t = tt.table[s.cluster].entry[i];
+
+            if (std::memcmp(&e, &s.original.entry[i], sizeof(TTEntry)) == 0)
+                continue;
+
+            if (t.depth8)
+                occ.add(t.genBound8 >> GenerationShift, -1);
+            if (e.depth8)
+                occ.add(e.genBound8 >> GenerationShift, 1);
+
+            t = e;
+        }
+    }
 
-    return cnt / ClusterSize;
+    start();
 }
 
 }  // namespace Stockfish
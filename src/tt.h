@@ -19,8 +19,13 @@
 #ifndef TT_H_INCLUDED
 #define TT_H_INCLUDED
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #include "misc.h"
 #include "types.h"
@@ -39,7 +44,45 @@ namespace Stockfish {
 // eval value 16 bit
 //
 // These fields are in the same order as accessed by TT::probe(), since memory is fastest sequentially.
-// Equally, the store order in save() matches this order.
+// Equally, the store order in save() matches this order, except that with
+// TT_VERIFY the key is written last.
+//
+// When compiled with TT_VERIFY the stored key is XORed with a 16 bit fold of the
+// other fields, so an entry torn by concurrent writers almost always no longer
+// matches its key and is treated as a miss instead of leaking a corrupt move or
+// value. Being 16 bits, the check still passes a torn entry by chance about once
+// in 65536. The fold is computed again from the data read by probe(), so the
+// check does not depend on the order in which the stores of save() become visible.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+class ClusteredTranspositionTable;
+
+// TTOccupancy counts, per generation, the entries a single thread has stored
+// minus the occupied entries it has overwritten. Summed over all the threads it
+// is the age histogram of the whole table, so hashfull() never has to scan it.
+// The counters are read by the main thread during the search, so they are
+// relaxed atomics like the node counters.
+struct alignas(64) TTOccupancy {
+    static constexpr int Generations = 32;  // Indexed by the 5 bit generation of the entry
+
+    TTOccupancy() = default;
+    TTOccupancy(const TTOccupancy& other) { *this = other; }
+    TTOccupancy& operator=(const TTOccupancy& other) {
+        for (int g = 0; g < Generations; ++g)
+            entries[g].store(other.count(g), std::memory_order_relaxed);
+        return *this;
+    }
+
+    int64_t count(int generation) const {
+        return entries[generation].load(std::memory_order_relaxed);
+    }
+    void add(int generation, int64_t n) {
+        entries[generation].fetch_add(n, std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<int64_t> entries[Generations] = {};
+};
+
 struct TTEntry {
 
     Move  move() const { return Move(move16); }
@@ -48,12 +91,31 @@ struct TTEntry {
     Depth depth() const { return Depth(depth8 + DEPTH_ENTRY_OFFSET); }
     bool  is_pv() const { return bool(genBound8 & 0x4); }
     Bound bound() const { return Bound(genBound8 & 0x3); }
-    void  save(Key k, Value v, bool pv, Bound b, Depth d, Move m, Value ev, uint8_t generation8);
+    void  save(Key          k,
+               Value        v,
+               bool         pv,
+               Bound        b,
+               Depth        d,
+               Move         m,
+               Value        ev,
+               uint8_t      generation8,
+               int          slot,
+               TTOccupancy& occupancy);
     // The returned age is a multiple of TranspositionTable::GENERATION_DELTA
     uint8_t relative_age(const uint8_t generation8) const;
 
    private:
-    friend class TranspositionTable;
+    template<int, int, typename>
+    friend class ClusteredTranspositionTable;
+    friend class HotTranspositionTable;
+    friend class TTCommitLog;
+
+#ifdef TT_VERIFY
+    uint16_t data_hash() const;
+#else
+    uint16_t data_hash() const { return 0; }
+#endif
+    uint16_t key() const { return key16 ^ data_hash(); }
 
     uint16_t key16;
     uint8_t  depth8;
@@ -63,23 +125,106 @@ struct TTEntry {
     int16_t  eval16;
 };
 
-class ThreadPool;
+// Replacement policies of a ClusteredTranspositionTable. When a new position
+// does not find its own or an empty entry in its full cluster, victim() picks
+// the entry to give up. When an entry is saved, overwrite() decides whether the
+// new data replaces the stored one, slot being the index of the entry within
+// its cluster, 0 in the direct-mapped hot table. The move is kept up to date
+// independently of the policy.
+namespace TTReplacement {
 
-// A TranspositionTable is an array of Cluster, of size clusterCount. Each
-// cluster consists of ClusterSize number of TTEntry. Each non-empty TTEntry
-// contains information on exactly one position. The size of a Cluster should
-// divide the size of a cache line for best performance, as the cacheline is
-// prefetched when possible.
-class TranspositionTable {
+// Entries are worth their depth minus 8 times their age. The data of the same
+// position is replaced by exact, not much shallower or newer results.
+struct DepthAge {
+    static TTEntry* victim(TTEntry* tte, int clusterSize, Key, uint8_t generation8) {
+        TTEntry* replace = tte;
+        for (int i = 1; i < clusterSize; ++i)
+            if (replace->depth() - replace->relative_age(generation8) * 2
+                > tte[i].depth() - tte[i].relative_age(generation8) * 2)
+                replace = &tte[i];
+        return replace;
+    }
 
-    static constexpr int ClusterSize = 3;
+    static bool overwrite(
+      const TTEntry& tte, bool sameKey, Bound b, Depth d, bool pv, uint8_t generation8, int) {
+        return b == BOUND_EXACT || !sameKey || d + 2 * pv > tte.depth() - 4
+            || tte.relative_age(generation8);
+    }
+};
+
+// Entries of older searches are replaced first, then the shallowest ones. The
+// data of the same position is only replaced by a result at least as deep.
+struct DepthPreferred {
+    static TTEntry* victim(TTEntry* tte, int clusterSize, Key, uint8_t generation8) {
+        TTEntry* replace = tte;
+        for (int i = 1; i < clusterSize; ++i)
+            if (tte[i].relative_age(generation8) > replace->relative_age(generation8)
+                || (tte[i].relative_age(generation8) == replace->relative_age(generation8)
+                    && tte[i].depth() < replace->depth()))
+                replace = &tte[i];
+        return replace;
+    }
+
+    static bool
+    overwrite(const TTEntry& tte, bool sameKey, Bound, Depth d, bool, uint8_t generation8, int) {
+        return !sameKey || d >= tte.depth() || tte.relative_age(generation8);
+    }
+};
+
+// Entries of older searches are replaced first. Otherwise bits of the key
+// select the entry, as in a direct-mapped table, and every save overwrites.
+struct AlwaysReplace {
+    static TTEntry* victim(TTEntry* tte, int clusterSize, Key key, uint8_t generation8) {
+        TTEntry* replace = &tte[(key >> 16) % clusterSize];
+        for (int i = 0; i < clusterSize; ++i)
+            if (tte[i].relative_age(generation8) > replace->relative_age(generation8))
+                replace = &tte[i];
+        return replace;
+    }
+
+    static bool overwrite(const TTEntry&, bool, Bound, Depth, bool, uint8_t, int) { return true; }
+};
+
+// The first entry of each cluster is a depth-preferred tier, the others are an
+// always-replace tier. As the depth of a new position is not known when its
+// entry is picked, the depth tier only takes new positions once its entry is
+// from an older search, and is otherwise kept for deeper results.
+struct TwoTier {
+    static TTEntry* victim(TTEntry* tte, int clusterSize, Key key, uint8_t generation8) {
+        return tte->relative_age(generation8)
+               ? tte
+               : AlwaysReplace::victim(tte + 1, clusterSize - 1, key, generation8);
+    }
+
+    static bool overwrite(
+      const TTEntry& tte, bool sameKey, Bound b, Depth d, bool pv, uint8_t generation8, int slot) {
+        return slot != 0 || DepthPreferred::overwrite(tte, sameKey, b, d, pv, generation8, slot);
+    }
+};
+
+}  // namespace TTReplacement
+
+class ThreadPool;
+class TTCommitLog;
+struct SharedTTHeader;
+
+// A ClusteredTranspositionTable is an array of Cluster, of size clusterCount.
+// Each cluster consists of ClusterSize number of TTEntry, padded to
+// ClusterBytes. Each non-empty TTEntry contains information on exactly one
+// position. The size of a Cluster should divide the size of a cache line for
+// best performance, as the cacheline is prefetched when possible.
+template<int ClusterSize, int ClusterBytes, typename Replacement>
+class ClusteredTranspositionTable {
 
     struct Cluster {
         TTEntry entry[ClusterSize];
-        char    padding[2];  // Pad to 32 bytes
+        char    padding[ClusterBytes - ClusterSize * sizeof(TTEntry)];
     };
 
-    static_assert(sizeof(Cluster) == 32, "Unexpected Cluster size");
+    static_assert(sizeof(Cluster) == ClusterBytes, "Unexpected Cluster size");
+    static_assert((ClusterBytes & (ClusterBytes - 1)) == 0, "Cluster size must be a power of 2");
+    static_assert(ClusterSize > 1 || !std::is_same_v<Replacement, TTReplacement::TwoTier>,
+                  "A two-tier cluster needs at least two entries");
 
     // Constants used to refresh the hash table periodically
 
@@ -93,31 +238,171 @@ class TranspositionTable {
     // mask to pull out generation number
     static constexpr int GENERATION_MASK = (0xFF << GENERATION_BITS) & 0xFF;
 
+    static_assert(TTOccupancy::Generations == 256 >> GENERATION_BITS,
+                  "TTOccupancy needs one counter per generation");
+
    public:
-    ~TranspositionTable() { aligned_large_pages_free(table); }
+    using ReplacementPolicy = Replacement;
 
-    void new_search() {
-        // increment by delta to keep lower bits as is
-        generation8 += GENERATION_DELTA;
-    }
+    ~ClusteredTranspositionTable() { free_table(); }
 
-    TTEntry* probe(const Key key, bool& found) const;
-    int      hashfull() const;
-    void     resize(size_t mbSize, ThreadPool& threads);
-    void     clear(ThreadPool& threads);
+    void             new_search();
+    TTEntry*         probe(const Key key, bool& found) const;
+    int              hashfull() const;
+    std::vector<int> hashfull_by_age(int ages) const;
+    void resize(size_t mbSize, ThreadPool& threads, const std::string& sharedName = "");
+    void clear(ThreadPool& threads);
+    void set_thread_count(size_t threadCount);
+    bool save_to_file(const std::string& filename) const;
+    bool load_from_file(const std::string& filename);
 
     TTEntry* first_entry(const Key key) const {
         return &table[mul_hi64(key, clusterCount)].entry[0];
     }
 
+    // Index of an entry of the table within its cluster
+    int slot(const TTEntry* tte) const {
+        const char* p = reinterpret_cast<const char*>(tte);
+        return int(size_t(p - reinterpret_cast<const char*>(table)) % sizeof(Cluster)
+                   / sizeof(TTEntry));
+    }
+
     uint8_t generation() const { return generation8; }
 
+    // Valid for thread indices below the thread count at the last clear()
+    TTOccupancy& occupancy(size_t threadIdx) { return occupancies[threadIdx]; }
+
+    TimePoint           allocation_time() const { return allocationTime; }
+    std::vector<size_t> page_count_by_numa_node() const;
+
    private:
     friend struct TTEntry;
+    friend class TTCommitLog;
+
+    // Returns the entry of the key in the cluster, or else the one to replace
+    static TTEntry* probe_cluster(TTEntry* tte, const Key key, bool& found, uint8_t generation8);
+
+    void free_table();
+    void count_occupancy();
+    bool attach_shared(const std::string& name, bool& created);
+
+    size_t          clusterCount;
+    Cluster*        table          = nullptr;
+    size_t          mappedSize     = 0;        // Non-zero if the table is memory-mapped
+    SharedTTHeader* shared         = nullptr;  // Non-null if the table is in shared memory
+    std::string     sharedPath;
+    TimePoint       allocationTime = 0;  // Time spent in the last resize(), 0 if kept, in ms
+    uint8_t         generation8    = 0;  // Size must be not bigger than TTEntry::genBound8
+
+    std::vector<TTOccupancy> occupancies;  // One per thread
+};
+
+// HotTranspositionTable is a small direct-mapped table of TTEntry owned by a
+// single search thread. At shallow depth it is probed before the shared table:
+// most probes near the leaves are for positions stored very recently, and a
+// table sized to stay in the L2 cache serves them without a DRAM access.
+class HotTranspositionTable {
+   public:
+    // Only nodes of at most this depth, including qsearch, use the hot table
+    static constexpr Depth MaxDepth = 2;
+
+    bool enabled() const { return !entries.empty(); }
+    bool contains(const TTEntry* tte) const {
+        return tte >= entries.data() && tte < entries.data() + entries.size();
+    }
+
+    TTEntry* probe(const Key key, bool& found) {
+        TTEntry* const tte = &entries[mul_hi64(key, entries.size())];
+        found              = tte->depth8 && tte->key() == uint16_t(key);
+        return tte;
+    }
+
+    void resize(size_t kbSize) {
+        entries.assign(kbSize * 1024 / sizeof(TTEntry), TTEntry{});
+        occupancy = TTOccupancy{};
+    }
+
+    TTOccupancy occupancy;  // Updated on saves, not part of the hashfull report
+
+   private:
+    std::vector<TTEntry> entries;
+};
+
+// Probe and hit counts of a search thread at each level of the table hierarchy,
+// only updated when SearchStatsEnabled
+struct TTProbeStats {
+    uint64_t hotProbes = 0, hotHits = 0;
+    uint64_t probes = 0, hits = 0;
+};
+
+// The replacement policy used by the search, selected with 'make ttreplace=...'
+#if defined(TT_REPLACE_DEPTH_PREFERRED)
+using TTReplacementPolicy = TTReplacement::DepthPreferred;
+#elif defined(TT_REPLACE_ALWAYS)
+using TTReplacementPolicy = TTReplacement::AlwaysReplace;
+#elif defined(TT_REPLACE_TWO_TIER)
+using TTReplacementPolicy = TTReplacement::TwoTier;
+#else
+using TTReplacementPolicy = TTReplacement::DepthAge;
+#endif
+
+// The cluster layout used by the search. The default fills half a cache line
+// with 3 entries. Building with 'make ttcluster=64' selects 64-byte clusters of
+// 6 entries, one full cache line per probe. TranspositionTable is a class
+// rather than an alias so that it can still be forward declared.
+#if defined(TT_CLUSTER_BYTES) && TT_CLUSTER_BYTES == 64
+class TranspositionTable: public ClusteredTranspositionTable<6, 64, TTReplacementPolicy> {};
+#else
+class TranspositionTable: public ClusteredTranspositionTable<3, 32, TTReplacementPolicy> {};
+#endif
+
+// TTCommitLog keeps the transposition table writes of a search thread private
+// until they are committed, for the deterministic SMP mode. Between two
+// synchronization points the threads only read the shared table: a thread
+// copies each cluster it probes into its log, where it then probes and saves
+// as usual. At the synchronization point the logs of all the threads are
+// committed in the order of the thread indices, so the table seen by every
+// thread no longer depends on how the threads were scheduled.
+class TTCommitLog {
+    using Cluster = TranspositionTable::Cluster;
+
+    struct Slot {
+        Cluster  data;
+        Cluster  original;  // As copied from the table, to find the modified entries
+        size_t   cluster;
+        uint32_t epoch;
+    };
 
-    size_t   clusterCount;
-    Cluster* table       = nullptr;
-    uint8_t  generation8 = 0;  // Size must be not bigger than TTEntry::genBound8
+   public:
+    // Sized for the commits of a thread every quantum nodes. With a few probes
+    // per node the log is never more than half full.
+    void resize(uint64_t quantum);
+    void start();  // Drops the clusters logged so far, at the start of a search
+
+    bool enabled() const { return !slots.empty(); }
+    bool contains(const TTEntry* tte) const {
+        const char* p = reinterpret_cast<const char*>(tte);
+        return p >= reinterpret_cast<const char*>(slots.data())
+            && p < reinterpret_cast<const char*>(slots.data() + slots.size());
+    }
+
+    TTEntry* probe(const TranspositionTable& tt, const Key key, bool& found);
+    void     commit(TranspositionTable& tt, TTOccupancy& occupancy);
+
+    // Index of an entry of the log within its cluster
+    int slot(const TTEntry* tte) const {
+        static_assert(offsetof(Slot, data) == 0);
+        const char* p = reinterpret_cast<const char*>(tte);
+        return int(size_t(p - reinterpret_cast<const char*>(slots.data())) % sizeof(Slot)
+                   / sizeof(TTEntry));
+    }
+
+    TTOccupancy occupancy;  // Updated on saves, the commit accounts for the table
+
+   private:
+    std::vector<Slot>   slots;
+    std::vector<size_t> touched;  // Slots used since the last commit
+    uint32_t            epoch = 1;
 };
 
 }  // namespace Stockfish
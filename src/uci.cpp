@@ -22,6 +22,9 @@
 #include <cctype>
 #include <cmath>
 #include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <string_view>
@@ -59,20 +62,40 @@ UCIEngine::UCIEngine(int argc, char** argv) :
     auto& options = engine.get_options();
 
     options["Debug Log File"] << Option("", [](const Option& o) { start_logger(o); });
+    options["Report Timings"] << Option(false);
 
     options["NumaPolicy"] << Option("auto", [this](const Option& o) {
         engine.set_numa_config_from_option(o);
         print_numa_config_information();
+        print_thread_resize_information();
         print_thread_binding_information();
+        print_tt_allocation_information();
     });
 
     options["Threads"] << Option(1, 1, 1024, [this](const Option&) {
         engine.resize_threads();
+        print_thread_resize_information();
         print_thread_binding_information();
+        print_tt_allocation_information();
     });
 
-    options["Hash"] << Option(16, 1, MaxHashMB, [this](const Option& o) { engine.set_tt_size(o); });
+    options["RootSplit"] << Option(false);
+    options["Deterministic"] << Option(false);
 
+    options["Hash"] << Option(16, 1, MaxHashMB, [this](const Option& o) {
+        engine.set_tt_size(o);
+        print_tt_allocation_information();
+    });
+
+    options["SharedHash"] << Option("", [this](const Option&) {
+        engine.set_tt_size(engine_options()["Hash"]);
+        print_tt_allocation_information();
+    });
+
+    options["HotHash"] << Option(0, 0, 16384,
+                                 [this](const Option& o) { engine.set_hot_tt_size(size_t(o)); });
+
+    options["HashfullByAge"] << Option(false);
     options["Clear Hash"] << Option([this](const Option&) { engine.search_clear(); });
     options["Ponder"] << Option(false);
     options["MultiPV"] << Option(1, 1, MAX_MOVES);
@@ -103,9 +126,10 @@ UCIEngine::UCIEngine(int argc, char** argv) :
     engine.search_clear();  // After threads are up
 }
 
-void UCIEngine::loop() {
+int UCIEngine::loop() {
 
     std::string token, cmd;
+    int         status = EXIT_SUCCESS;
 
     for (int i = 1; i < cli.argc; ++i)
         cmd += std::string(cli.argv[i]) + " ";
@@ -149,7 +173,14 @@ void UCIEngine::loop() {
         else if (token == "position")
             position(is);
         else if (token == "ucinewgame")
+        {
             engine.search_clear();
+
+            // Only reported on request, as GUIs send this before each game
+            if (engine.get_options()["Report Timings"])
+                sync_cout << "info string Clear Time: " << engine.get_search_clear_time()
+                          << "ms" << sync_endl;
+        }
         else if (token == "isready")
             sync_cout << "readyok" << sync_endl;
 
@@ -159,6 +190,52 @@ void UCIEngine::loop() {
             engine.flip();
         else if (token == "bench")
             bench(is);
+        else if (token == "batch")
+        {
+            if (batch(is))
+                token = "quit";
+        }
+        else if (token == "enginebench")
+            engine_bench(is);
+        else if (token == "stats")
+            search_stats(is);
+        else if (token == "ttstress")
+        {
+            // ttstress [max threads] [ms per thread count] [hash MB]
+            size_t    maxThreads = 256, mb = 1;
+            TimePoint runTime    = 1000;
+
+            is >> maxThreads >> runTime >> mb;
+            engine.tt_stress(maxThreads, std::max(runTime, TimePoint(1)), std::max(mb, size_t(1)));
+        }
+        else if (token == "evalbatch")
+        {
+            // evalbatch [ms per batch size]
+            TimePoint runTime = 500;
+
+            is >> runTime;
+            engine.eval_batch(std::max(runTime, TimePoint(1)));
+        }
+        else if (token == "accupdate")
+        {
+            // accupdate [ms per gap]
+            TimePoint runTime = 500;
+
+            is >> runTime;
+            engine.accumulator_update(std::max(runTime, TimePoint(1)));
+        }
+        else if (token == "nnuebench")
+        {
+            // nnuebench [ms per operation] [file with 'position' arguments]
+            TimePoint   runTime = 500;
+            std::string file;
+
+            is >> runTime >> file;
+
+            // A failure only ends the process when run from the command line, as in CI
+            if (!engine.nnue_bench(std::max(runTime, TimePoint(1)), file))
+                status = EXIT_FAILURE;
+        }
         else if (token == "d")
             sync_cout << engine.visualize() << sync_endl;
         else if (token == "eval")
@@ -177,6 +254,17 @@ void UCIEngine::loop() {
 
             engine.save_network(files);
         }
+        else if (token == "export_tt" || token == "import_tt")
+        {
+            std::string file;
+
+            if (!(is >> std::skipws >> file))
+                sync_cout << "info string Usage: " << token << " <file>" << sync_endl;
+            else if (token == "export_tt")
+                engine.save_tt(file);
+            else
+                engine.load_tt(file);
+        }
         else if (token == "--help" || token == "help" || token == "--license" || token == "license")
             sync_cout
               << "\nStockfish is a powerful chess engine for playing and analyzing."
@@ -191,11 +279,17 @@ void UCIEngine::loop() {
                       << sync_endl;
 
     } while (token != "quit" && cli.argc == 1);  // The command-line arguments are one-shot
+
+    return cli.argc == 1 ? EXIT_SUCCESS : status;
 }
 
 void UCIEngine::print_numa_config_information() const {
     auto cfgStr = engine.get_numa_config_as_string();
     sync_cout << "info string Available Processors: " << cfgStr << sync_endl;
+
+    auto coreClasses = engine.get_core_classes_as_string();
+    if (!coreClasses.empty())
+        sync_cout << "info string Core Capacities: " << coreClasses << sync_endl;
 }
 
 void UCIEngine::print_thread_binding_information() const {
@@ -213,6 +307,52 @@ void UCIEngine::print_thread_binding_information() const {
         }
         std::cout << sync_endl;
     }
+
+    auto boundThreadsByCapacity = engine.get_bound_thread_count_by_capacity();
+    if (!boundThreadsByCapacity.empty())
+    {
+        sync_cout << "info string Core Class Thread Binding:";
+        for (auto&& [capacity, count] : boundThreadsByCapacity)
+            std::cout << " " << capacity << ":" << count;
+        std::cout << sync_endl;
+    }
+}
+
+// The timings are only printed with Report Timings, as GUIs set the options
+// they depend on before each game.
+void UCIEngine::print_thread_resize_information() const {
+    if (engine.get_options()["Report Timings"])
+        sync_cout << "info string Thread Pool Resize Time: " << engine.get_thread_resize_time()
+                  << "ms" << sync_endl;
+}
+
+void UCIEngine::print_tt_allocation_information() const {
+    if (engine.get_options()["Report Timings"])
+        sync_cout << "info string Hash Allocation Time: " << engine.get_tt_allocation_time()
+                  << "ms" << sync_endl;
+
+    // Placement is only worth reporting if the table is spread over several nodes
+    auto   pagesByNode = engine.get_tt_page_count_by_numa_node();
+    size_t total = 0, usedNodes = 0;
+    for (size_t pages : pagesByNode)
+    {
+        total += pages;
+        usedNodes += pages > 0;
+    }
+
+    if (usedNodes > 1)
+    {
+        sync_cout << "info string NUMA Node Hash Placement: ";
+        bool isFirst = true;
+        for (size_t pages : pagesByNode)
+        {
+            if (!isFirst)
+                std::cout << ":";
+            std::cout << pages * 100 / total << "%";
+            isFirst = false;
+        }
+        std::cout << sync_endl;
+    }
 }
 
 Search::LimitsType UCIEngine::parse_limits(std::istream& is) {
@@ -264,12 +404,114 @@ void UCIEngine::go(std::istringstream& is) {
         engine.go(limits);
 }
 
+// batch [groups <n>] <go limits>, followed by one FEN per line up to 'end'.
+// The positions are searched concurrently by n groups of threads, and a
+// 'batchresult' line is printed for each of them as soon as it is done.
+// 'stop' or 'quit' instead of a FEN stops the batch. Returns true on 'quit'.
+bool UCIEngine::batch(std::istream& args) {
+    std::string token;
+    size_t      groups = engine.get_options()["Threads"];
+
+    std::streampos limitsStart = args.tellg();
+    if (args >> token && token == "groups")
+        args >> groups;
+    else
+    {
+        args.clear();
+        args.seekg(limitsStart);
+    }
+
+    Search::LimitsType limits = parse_limits(args);
+
+    if (limits.perft || limits.infinite || limits.ponderMode
+        || !(limits.depth || limits.nodes || limits.movetime || limits.mate
+             || limits.use_time_management()))
+    {
+        sync_cout << "info string Usage: batch [groups <n>] <finite go limits>" << sync_endl;
+        return false;
+    }
+
+    // The hash tables of the groups come on top of the one of the engine
+    const size_t groupCount =
+      std::clamp(groups, size_t(1), size_t(engine.get_options()["Threads"]));
+    sync_cout << "info string Batch hash: " << groupCount << " x "
+              << engine.batch_group_hash(groupCount) << " MB, in addition to Hash" << sync_endl;
+
+    bool quit     = false;
+    auto next_fen = [&](std::string& fen) {
+        while (std::getline(std::cin, fen) && fen != "end")
+        {
+            if (fen == "stop" || fen == "quit")
+            {
+                quit = fen == "quit";
+                engine.stop();
+                return false;
+            }
+
+            if (!fen.empty())
+                return true;
+        }
+
+        return false;
+    };
+
+    engine.search_batch(groups, limits, next_fen, [](const Engine::BatchResult& r) {
+        sync_cout << "batchresult " << r.index << " depth " << r.depth << " score "
+                  << format_score(r.score) << " nodes " << r.nodes << " time " << r.timeMs
+                  << " pv " << r.pv << " bestmove " << r.bestmove << sync_endl;
+    });
+
+    return quit;
+}
+
+// Creates the given number of engines in this process, as a server hosting many
+// games would do, and reports the startup time and the resident memory as they
+// are added. The engines share the networks of this one, so each one costs
+// about its hash table and its workers.
+void UCIEngine::engine_bench(std::istream& args) {
+    size_t count = 16;
+    args >> count;
+
+    auto rss_mib = [] {
+        auto rss = Benchmark::resident_memory();
+        return rss ? std::to_string(*rss >> 20) + " MiB" : std::string("n/a");
+    };
+
+    const auto rssBefore = Benchmark::resident_memory();
+
+    std::vector<std::unique_ptr<UCIEngine>> engines;
+    TimePoint                               elapsed = 0;
+
+    for (size_t i = 1; i <= count; ++i)
+    {
+        const TimePoint start = now();
+        engines.push_back(std::make_unique<UCIEngine>(cli.argc, cli.argv));
+        elapsed += now() - start;
+
+        if ((i & (i - 1)) == 0 || i == count)
+            sync_cout << "info string Engines: " << i << " Startup: " << elapsed
+                      << "ms RSS: " << rss_mib() << sync_endl;
+    }
+
+    const auto rssAfter = Benchmark::resident_memory();
+
+    std::cerr << "\n==========================="
+              << "\nEngines created     : " << count
+              << "\nStartup time (ms)   : " << elapsed
+              << "\nStartup per engine  : " << (count ? elapsed / TimePoint(count) : 0) << "ms";
+    if (rssBefore && rssAfter && count)
+        std::cerr << "\nRSS per engine (KiB): " << (*rssAfter - *rssBefore) / count / 1024;
+    std::cerr << std::endl;
+}
+
 void UCIEngine::bench(std::istream& args) {
     std::string token;
     uint64_t    num, nodes = 0, cnt = 1;
     uint64_t    nodesSearched = 0;
     const auto& options       = engine.get_options();
 
+    std::optional<uint64_t> tlbMisses;
+
     engine.set_on_update_full([&](const auto& i) {
         nodesSearched = i.nodes;
         on_update_full(i, options["UCI_ShowWDL"]);
@@ -299,8 +541,13 @@ void UCIEngine::bench(std::istream& args) {
                     nodes = perft(limits);
                 else
                 {
+                    Benchmark::TlbMissCounter tlbMissCounter;  // Counts the search threads
+
                     engine.go(limits);
                     engine.wait_for_search_finished();
+
+                    if (tlbMissCounter.valid())
+                        tlbMisses = tlbMisses.value_or(0) + tlbMissCounter.count();
                 }
 
                 nodes += nodesSearched;
@@ -328,11 +575,117 @@ void UCIEngine::bench(std::istream& args) {
               << "\nTotal time (ms) : " << elapsed << "\nNodes searched  : " << nodes
               << "\nNodes/second    : " << 1000 * nodes / elapsed << std::endl;
 
+    // Hit ratios of both levels of the transposition table, in percent. The probes
+    // are only counted in 'make searchstats=yes' builds, see SearchStatsEnabled.
+    TTProbeStats stats = engine.get_tt_probe_stats();
+    if (stats.hotProbes)
+        std::cerr << "Hot TT hits     : " << 100 * stats.hotHits / stats.hotProbes << "% of "
+                  << stats.hotProbes << " probes" << std::endl;
+    if (stats.probes)
+        std::cerr << "TT hits         : " << 100 * stats.hits / stats.probes << "% of "
+                  << stats.probes << " probes" << std::endl;
+
+    // Data TLB misses of the search threads, if the OS lets us count them
+    if (tlbMisses)
+        std::cerr << "dTLB misses     : " << *tlbMisses << " (" << *tlbMisses * 1000 / (nodes + 1)
+                  << " per 1000 nodes)" << std::endl;
+
+    if constexpr (SearchStatsEnabled)
+    {
+        std::istringstream noArgs;
+        search_stats(noArgs);
+    }
+
     // reset callback, to not capture a dangling reference to nodesSearched
     engine.set_on_update_full([&](const auto& i) { on_update_full(i, options["UCI_ShowWDL"]); });
 }
 
 
+// stats [json [<file>]]
+// Reports the statistics of each thread since the last ucinewgame, either as
+// info strings or as a JSON document written to the given file or to stdout.
+void UCIEngine::search_stats(std::istream& args) {
+    if constexpr (!SearchStatsEnabled)
+    {
+        sync_cout << "info string Search statistics are not available, "
+                     "build with 'make searchstats=yes'"
+                  << sync_endl;
+        return;
+    }
+
+    engine.wait_for_search_finished();
+
+    std::string format, file;
+    args >> format >> file;
+
+    auto fields = [](const Search::SearchStats& s) {
+        return std::vector<std::pair<std::string_view, uint64_t>>{
+          {"nodes", s.nodes},
+          {"qsearchNodes", s.qsearchNodes},
+          {"ttProbes", s.ttProbes},
+          {"ttHits", s.ttHits},
+          {"hotTTProbes", s.hotTTProbes},
+          {"hotTTHits", s.hotTTHits},
+          {"nnueRefreshes", s.nnueRefreshes},
+          {"nnueUpdates", s.nnueUpdates},
+          {"nnueDeferred", s.nnueDeferred},
+          {"nnueSaved", s.nnueSaved},
+          {"tbProbes", s.tbProbes},
+          {"tbHits", s.tbHits},
+          {"waitTimeUs", s.waitTimeUs}};
+    };
+
+    const auto          threadStats = engine.get_search_stats();
+    Search::SearchStats total;
+    for (const auto& s : threadStats)
+        total += s;
+
+    std::stringstream ss;
+
+    if (format == "json")
+    {
+        auto object = [&](const Search::SearchStats& s) {
+            bool isFirst = true;
+            ss << "{";
+            for (auto&& [name, value] : fields(s))
+            {
+                ss << (isFirst ? "" : ", ") << "\"" << name << "\": " << value;
+                isFirst = false;
+            }
+            ss << "}";
+        };
+
+        ss << "{\n  \"threads\": [";
+        for (size_t i = 0; i < threadStats.size(); ++i)
+        {
+            ss << (i ? ",\n    " : "\n    ");
+            object(threadStats[i]);
+        }
+        ss << "\n  ],\n  \"total\": ";
+        object(total);
+        ss << "\n}";
+
+        if (file.empty())
+            sync_cout << ss.str() << sync_endl;
+        else if (!(std::ofstream(file) << ss.str() << std::endl))
+            sync_cout << "info string Failed to write " << file << sync_endl;
+        return;
+    }
+
+    auto line = [&](const std::string& who, const Search::SearchStats& s) {
+        ss << "info string " << who << ":";
+        for (auto&& [name, value] : fields(s))
+            ss << " " << name << " " << value;
+        ss << "\n";
+    };
+
+    for (size_t i = 0; i < threadStats.size(); ++i)
+        line("Thread " + std::to_string(i), threadStats[i]);
+    line("Total", total);
+
+    sync_cout << ss.str().substr(0, ss.str().size() - 1) << sync_endl;
+}
+
 void UCIEngine::setoption(std::istringstream& is) {
     engine.wait_for_search_finished();
     engine.get_options().setoption(is);
@@ -516,6 +869,9 @@ void UCIEngine::on_update_full(const Engine::InfoFull& info, bool showWDL) {
        << " time " << info.timeMs        //
        << " pv " << info.pv;             //
 
+    if (!info.hashfullByAge.empty())
+        ss << "\ninfo string Hashfull By Age: " << info.hashfullByAge;
+
     sync_cout << ss.str() << sync_endl;
 }
 
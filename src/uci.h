@@ -40,10 +40,12 @@ class UCIEngine {
    public:
     UCIEngine(int argc, char** argv);
 
-    void loop();
+    int loop();  // Returns the exit status of the process
 
     void print_numa_config_information() const;
     void print_thread_binding_information() const;
+    void print_thread_resize_information() const;
+    void print_tt_allocation_information() const;
 
     static int         to_cp(Value v, const Position& pos);
     static std::string format_score(const Score& s);
@@ -63,6 +65,9 @@ class UCIEngine {
 
     void          go(std::istringstream& is);
     void          bench(std::istream& args);
+    bool          batch(std::istream& args);
+    void          engine_bench(std::istream& args);
+    void          search_stats(std::istream& args);
     void          position(std::istringstream& is);
     void          setoption(std::istringstream& is);
     std::uint64_t perft(const Search::LimitsType&);
@@ -46,9 +46,10 @@ race:Stockfish::TTEntry::save
 race:Stockfish::TTEntry::value
 race:Stockfish::TTEntry::eval
 race:Stockfish::TTEntry::is_pv
+race:Stockfish::TTEntry::key
+race:Stockfish::TTEntry::data_hash
 
-race:Stockfish::TranspositionTable::probe
-race:Stockfish::TranspositionTable::hashfull
+race:Stockfish::ClusteredTranspositionTable*::probe_cluster
 
 EOF
 
@@ -0,0 +1,69 @@
+#!/bin/bash
+# verify reproducible multi-threaded search with the Deterministic option
+
+error()
+{
+  echo "reprothreads testing failed on line $1"
+  exit 1
+}
+trap 'error ${LINENO}' ERR
+
+echo "reprothreads testing started"
+
+# reads the engine output up to the bestmove into line, fails if it does not
+# come in time
+wait_bestmove()
+{
+  while read -t 30 -r line <&"${ENGINE[0]}"; do
+    [[ $line == bestmove* ]] && return 0
+  done
+  return 1
+}
+
+# searches $1 nodes from two positions in a fresh engine with 4 threads, and
+# prints the best move of each search. The node counts of the info lines are
+# not compared, the last one is read while the helper threads still unwind.
+run()
+{
+  coproc ENGINE { eval "$WINE_PATH ./stockfish" 2>&1; }
+  echo "setoption name Threads value 4" >&"${ENGINE[1]}"
+  echo "setoption name Deterministic value true" >&"${ENGINE[1]}"
+
+  for moves in "" "moves e2e4 e7e6"; do
+    echo "position startpos $moves" >&"${ENGINE[1]}"
+    echo "go nodes $1" >&"${ENGINE[1]}"
+    wait_bestmove || line="no bestmove"
+    echo "$line"
+  done
+
+  # a search which has reached its depth while pondering ends on ponderhit
+  echo "go ponder depth 4" >&"${ENGINE[1]}"
+  sleep 1
+  echo "ponderhit" >&"${ENGINE[1]}"
+  wait_bestmove || line="no bestmove after ponderhit"
+  echo "$line"
+
+  echo "quit" >&"${ENGINE[1]}"
+  wait
+}
+
+for nodes in 10000 50000 200000
+do
+
+  echo "reprothreads testing with $nodes nodes"
+
+  first=$(run $nodes)
+  second=$(run $nodes)
+
+  [ "$(echo "$first" | grep -c "^bestmove")" == 3 ]
+
+  if [ "$first" != "$second" ]; then
+    echo "runs differ:"
+    echo "$first"
+    echo "$second"
+    exit 1
+  fi
+
+done
+
+echo "reprothreads testing OK"